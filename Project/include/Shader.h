@@ -1,4 +1,120 @@
 ﻿#pragma once
+#include <glm/glm.hpp>
+
+// Uniform blocks shared by the shaders below, fed from the per-frame uniform ring.
+// The C++ structs mirror the std140 layouts
+const unsigned int frameBlockBinding = 2;
+const unsigned int objectBlockBinding = 3;
+const unsigned int rayCastScreenBlockBinding = 4;
+// head pose, latched into the ring just before the scene draws are submitted
+const unsigned int poseBlockBinding = 5;
+// rotational timewarp of the distortion pass, written right before the distortion draw
+const unsigned int timewarpBlockBinding = 6;
+// shader storage binding of the SceneBatch draw data (DrawData in SceneBatch.h)
+const unsigned int drawDataBinding = 0;
+
+// how the distortion pass lays the eyes out in the window, the scene target
+// holds one array layer per eye for both stereo layouts
+enum StereoLayout { kStereoMono = 0, kStereoSideBySide = 1, kStereoTopBottom = 2 };
+
+struct FrameBlock {
+    float time;
+    int useLighting;  // std140 bool
+    int dualLighting;
+    int applyDistortion;
+    int stereoLayout; // StereoLayout
+    int sceneSamples; // of the multisample scene color the distortion pass resolves
+    int sceneBilinear; // std140 bool, filter between the resolved scene texels
+    int padding;
+    // fovea edges (x0, y0, x1, y1) of the multi-resolution scene (MultiResLayout) in the
+    // eye's image, and the piecewise linear map to the scene target as coefficients
+    // (MultiResLayout::GetTargetMapping), the identity when the scene is rendered uniformly
+    glm::vec4 multiResViewEdges;
+    glm::vec4 multiResMiddle;
+    glm::vec4 multiResSlopes;
+};
+
+// the eyes' views (mono uses the first), kept out of FrameBlock so they can be written
+// as late as possible. A vertex belongs to eye firstEye + gl_InstanceID % instanceEyes,
+// or to the multiview view, and to viewport gl_InstanceID / instanceEyes
+struct PoseBlock {
+    glm::mat4 view[2];
+    glm::mat4 projection[2];
+    glm::vec4 viewPos[2]; // xyz
+    int firstEye;         // eye of instance 0, the pass's eye when the eyes are drawn one by one
+    int instanceEyes;     // 2 when each draw covers both eyes through its instances, else 1
+    int instanceCells;    // 9 when the instances also cover the multi-resolution cells, else 1
+    int padding;
+};
+
+// per eye, the rotation from the latest head pose back to the pose the scene was rendered
+// with, as a homography between their normalized device coordinates (timewarpMatrix)
+struct TimewarpBlock {
+    glm::mat4 timewarp[2];
+};
+
+struct ObjectBlock {
+    glm::mat4 model;
+    glm::mat4 normalMatrix;
+};
+
+struct RayCastScreenBlock {
+    glm::vec4 eyeLocal[2]; // each eye's viewPos in the screen's local space, xyz
+    glm::vec3 boxMin;      // proxy bounds in the local space
+    float radius;
+    glm::vec3 boxMax;
+    float height;
+    float arcAngle;
+    float padding[3];
+};
+
+// GLSL of FrameBlock and PoseBlock, spliced into every shader after the #version
+// line (shaderVariant) so the declarations stay in one place
+const char* uniformBlocksHeader = R"(
+        layout (std140, binding = 2) uniform FrameBlock {
+            float time;
+            bool u_b_useLighting;
+            bool u_b_dualLighting;
+            bool u_b_applyDistortion;
+            int u_stereoLayout; // 0 mono, 1 side by side, 2 top-bottom
+            int u_sceneSamples;
+            bool u_sceneBilinear;
+            vec4 u_multiResViewEdges;
+            vec4 u_multiResMiddle;
+            vec4 u_multiResSlopes;
+        };
+        layout (std140, binding = 5) uniform PoseBlock {
+            mat4 view[2];
+            mat4 projection[2];
+            vec4 viewPos[2];
+            int firstEye;
+            int instanceEyes;
+            int instanceCells;
+        };
+    )";
+
+// Stereo variants of the scene vertex shaders, spliced in after the #version line
+// (shaderVariant). STEREO_EYE is the eye of the vertex, STEREO_ROUTE(eye) sends it to
+// that eye's layer of the scene target.
+// instanced stereo: the eye comes from the instance, the layer is written per vertex.
+// The instances after the eyes pick the viewport, one per multi-resolution cell
+const char* stereoLayerHeader = R"(
+        #extension GL_ARB_shader_viewport_layer_array : require
+        #define STEREO_EYE (firstEye + gl_InstanceID % instanceEyes)
+        #define STEREO_ROUTE(eye) gl_Layer = (eye); gl_ViewportIndex = gl_InstanceID / instanceEyes % instanceCells
+    )";
+// no per-vertex layer: the eyes are drawn one by one into their selected layer
+const char* stereoPassHeader = R"(
+        #define STEREO_EYE firstEye
+        #define STEREO_ROUTE(eye)
+    )";
+// GL_OVR_multiview2: every draw runs once per view and lands in the view's layer
+const char* stereoMultiviewHeader = R"(
+        #extension GL_OVR_multiview2 : require
+        layout (num_views = 2) in;
+        #define STEREO_EYE int(gl_ViewID_OVR)
+        #define STEREO_ROUTE(eye)
+    )";
 
 // shader source code
 const char* sceneVertexShader = R"(
@@ -6,21 +122,102 @@ const char* sceneVertexShader = R"(
         layout (location = 0) in vec3 aPos;
         layout (location = 1) in vec3 aNormal;
         layout (location = 2) in vec2 aTexCoords;
+        // attributes may be packed (half pos, 2_10_10_10 normal, unorm16 uv),
+        // the normalized vertex fetch already decodes them to float
+        // index into the draw data, per instance through the indirect command's baseInstance
+        layout (location = 3) in uint aDrawID;
+        
+        out vec3 FragPos;
+        out vec3 Normal;
+        out vec2 TexCoords;
+        flat out vec4 Tint;
+        flat out int Eye;
+        
+        struct DrawData {
+            mat4 model;
+            mat4 normalMatrix; // transpose(inverse(model)), upper 3x3
+            vec4 color;        // rgb tint, a = 1: textured
+        };
+        layout (std430, binding = 0) readonly buffer DrawDataBuffer {
+            DrawData draws[];
+        };
+        
+        void main() {
+            DrawData draw = draws[aDrawID];
+            FragPos = vec3(draw.model * vec4(aPos, 1.0));
+            Normal = mat3(draw.normalMatrix) * normalize(aNormal);
+            TexCoords = aTexCoords;
+            Tint = draw.color;
+            
+            int eye = STEREO_EYE;
+            Eye = eye;
+            gl_Position = projection[eye] * view[eye] * vec4(FragPos, 1.0);
+            STEREO_ROUTE(eye);
+        }
+    )";
+
+// binding point of the BezierPatch uniform block
+const unsigned int bezierPatchBlockBinding = 1;
+
+// ring screen evaluated from the shared (u,v) grid and 16 control points
+const char* sceneBezierVertexShader = R"(
+        #version 430 core
+        layout (location = 2) in vec2 aTexCoords;
         
         out vec3 FragPos;
         out vec3 Normal;
         out vec2 TexCoords;
+        flat out vec4 Tint;
+        flat out int Eye;
         
-        uniform mat4 model;
-        uniform mat4 view;
-        uniform mat4 projection;
+        layout (std140, binding = 3) uniform ObjectBlock {
+            mat4 model;
+            mat4 normalMatrix; // transpose(inverse(model)), upper 3x3
+        };
+
+        // controlPoints[i * 4 + j]: i along u, j along v (w unused)
+        layout (std140, binding = 1) uniform BezierPatch {
+            vec4 controlPoints[16];
+        };
+
+        vec4 bernstein(float t) {
+            float s = 1.0 - t;
+            return vec4(s * s * s, 3.0 * t * s * s, 3.0 * t * t * s, t * t * t);
+        }
+
+        vec4 bernsteinDeriv(float t) {
+            float s = 1.0 - t;
+            return vec4(-3.0 * s * s, 3.0 * s * s - 6.0 * t * s, 6.0 * t * s - 3.0 * t * t, 3.0 * t * t);
+        }
         
         void main() {
-            FragPos = vec3(model * vec4(aPos, 1.0));
-            Normal = mat3(transpose(inverse(model))) * aNormal;
+            vec4 bu = bernstein(aTexCoords.x);
+            vec4 dbu = bernsteinDeriv(aTexCoords.x);
+            vec4 bv = bernstein(aTexCoords.y);
+            vec4 dbv = bernsteinDeriv(aTexCoords.y);
+
+            vec3 pos = vec3(0.0);
+            vec3 du = vec3(0.0);
+            vec3 dv = vec3(0.0);
+            for (int i = 0; i < 4; ++i) {
+                for (int j = 0; j < 4; ++j) {
+                    vec3 cp = controlPoints[i * 4 + j].xyz;
+                    pos += bu[i] * bv[j] * cp;
+                    du += dbu[i] * bv[j] * cp;
+                    dv += bu[i] * dbv[j] * cp;
+                }
+            }
+            vec3 aNormal = normalize(cross(du, dv));
+
+            FragPos = vec3(model * vec4(pos, 1.0));
+            Normal = mat3(normalMatrix) * aNormal;
             TexCoords = aTexCoords;
+            Tint = vec4(1.0);
             
-            gl_Position = projection * view * vec4(FragPos, 1.0);
+            int eye = STEREO_EYE;
+            Eye = eye;
+            gl_Position = projection[eye] * view[eye] * vec4(FragPos, 1.0);
+            STEREO_ROUTE(eye);
         }
     )";
 
@@ -29,17 +226,18 @@ const char* sceneFragmentShader = R"(
         in vec3 FragPos;
         in vec3 Normal;
         in vec2 TexCoords;
+        flat in vec4 Tint;
+        flat in int Eye;
         
         out vec4 FragColor;
         
         uniform sampler2D screenTexture;
-        uniform vec3 viewPos;
-        uniform bool u_b_useLighting;
-        uniform bool u_b_dualLighting;
         
         void main() {
-            // basic Texture color
-            vec4 texColor = texture(screenTexture, vec2(1.0 - TexCoords.x, TexCoords.y));
+            // basic Texture color, untextured draws use their tint alone
+            vec4 texColor = vec4(Tint.rgb, 1.0);
+            if (Tint.a > 0.5)
+                texColor *= texture(screenTexture, vec2(1.0 - TexCoords.x, TexCoords.y));
             
             if (u_b_useLighting) {
                 // simple light
@@ -57,7 +255,7 @@ const char* sceneFragmentShader = R"(
                 vec3 ambient = vec3(0.2, 0.2, 0.2);
                 
                 // specular 
-                vec3 viewDir = normalize(viewPos - FragPos);
+                vec3 viewDir = normalize(viewPos[Eye].xyz - FragPos);
                 vec3 reflectDir = reflect(-lightDir, norm);
                 float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
                 vec3 specular = spec * vec3(0.5);
@@ -69,59 +267,245 @@ const char* sceneFragmentShader = R"(
         }
     )";
 
-const char* distortionVertexShader = R"(
+// ring screen ray-cast against the exact cylinder section, drawn on a bounding box proxy
+const char* sceneRayCastVertexShader = R"(
         #version 430 core
-        layout (location = 0) in vec2 aPos;
-        layout (location = 1) in vec2 aTexCoords;
+        layout (location = 0) in vec3 aPos; // unit cube, [-1, 1]
         
-        out vec2 TexCoords;
+        out vec3 LocalPos;
+        flat out int Eye;
+        
+        layout (std140, binding = 3) uniform ObjectBlock {
+            mat4 model;
+            mat4 normalMatrix; // transpose(inverse(model)), upper 3x3
+        };
+        layout (std140, binding = 4) uniform RayCastScreenBlock {
+            vec4 eyeLocal[2]; // each eye's viewPos in the local space
+            vec3 boxMin;      // screen bounds in the local (patch) space
+            float radius;
+            vec3 boxMax;
+            float height;
+            float arcAngle;
+        };
         
         void main() {
-            gl_Position = vec4(aPos, 0.0, 1.0);
-            TexCoords = aTexCoords;
+            LocalPos = mix(boxMin, boxMax, aPos * 0.5 + 0.5);
+            int eye = STEREO_EYE;
+            Eye = eye;
+            gl_Position = projection[eye] * view[eye] * model * vec4(LocalPos, 1.0);
+            STEREO_ROUTE(eye);
         }
     )";
 
-const char* distortionFragmentShader = R"(
+const char* sceneRayCastFragmentShader = R"(
         #version 430 core
-        in vec2 TexCoords;
+        in vec3 LocalPos;
+        flat in int Eye;
+        
         out vec4 FragColor;
         
         uniform sampler2D screenTexture;
-        uniform float time;
-        uniform bool u_b_applyDistortion;
+        layout (std140, binding = 3) uniform ObjectBlock {
+            mat4 model;
+            mat4 normalMatrix; // transpose(inverse(model)), upper 3x3
+        };
+        layout (std140, binding = 4) uniform RayCastScreenBlock {
+            vec4 eyeLocal[2]; // each eye's viewPos in the local space
+            vec3 boxMin;
+            float radius;
+            vec3 boxMax;
+            float height;
+            float arcAngle;
+        };
         
         void main() {
-            vec2 uv = TexCoords;
+            // cylinder axis runs along y through (0, *, radius), intersect in the xz plane
+            vec3 eyePos = eyeLocal[Eye].xyz;
+            vec3 dir = normalize(LocalPos - eyePos);
+            vec2 o = vec2(eyePos.x, eyePos.z - radius);
+            vec2 d = dir.xz;
+            float a = dot(d, d);
+            float b = dot(o, d);
+            float c = dot(o, o) - radius * radius;
+            float disc = b * b - a * c;
+            if (disc < 0.0 || a < 1e-8)
+                discard;
             
-            if (u_b_applyDistortion) {
-                // VR distortion effect
-                vec2 center = vec2(0.5, 0.5);
-                float dist = distance(uv, center);
-                vec2 dir = normalize(uv - center);
-                
-                // barrel distortion
-                float distortion = 0.15 * sin(time * 0.5) + 0.25;
-                float scale = 1.0 + distortion * dist * dist;
-                
-                uv = center + dir * dist * scale;
+            float s = sqrt(disc);
+            float roots[2] = float[2]((-b - s) / a, (-b + s) / a);
+            
+            bool hit = false;
+            vec3 p;
+            vec3 n;
+            float theta;
+            for (int k = 0; k < 2 && !hit; ++k) {
+                if (roots[k] <= 0.0)
+                    continue;
+                vec3 q = eyePos + roots[k] * dir;
+                float qTheta = atan(q.x, radius - q.z);
+                // inward normal, the side the tessellated screen faces
+                vec3 qNormal = vec3(-q.x, 0.0, radius - q.z) / radius;
+                // back faces are culled for the mesh, skip them here too
+                if (abs(q.y) <= 0.5 * height && abs(qTheta) <= 0.5 * arcAngle && dot(qNormal, dir) < 0.0) {
+                    hit = true;
+                    p = q;
+                    n = qNormal;
+                    theta = qTheta;
+                }
+            }
+            if (!hit)
+                discard;
+            
+            // exact parameters: u is the arc fraction, v the height fraction
+            vec2 TexCoords = vec2(theta / arcAngle + 0.5, p.y / height + 0.5);
+            vec3 FragPos = vec3(model * vec4(p, 1.0));
+            vec3 Normal = mat3(normalMatrix) * n;
+            
+            vec4 clipPos = projection[Eye] * view[Eye] * vec4(FragPos, 1.0);
+            gl_FragDepth = 0.5 * (clipPos.z / clipPos.w) + 0.5;
+            
+            // basic Texture color
+            vec4 texColor = texture(screenTexture, vec2(1.0 - TexCoords.x, TexCoords.y));
+            
+            if (u_b_useLighting) {
+                // simple light, only front faces are hit so no dual lighting flip
+                vec3 norm = normalize(Normal);
+                vec3 lightDir = normalize(vec3(1.0, 1.0, 1.0));
+                float diff = max(dot(norm, lightDir), 0.0);
+                vec3 diffuse = diff * vec3(0.8, 0.8, 0.8);
                 
-                // Chromatic effects
-                float chroma = 0.005;
-                vec2 offsetR = dir * dist * chroma;
-                vec2 offsetB = dir * dist * chroma * -1.0;
+                // ambient 
+                vec3 ambient = vec3(0.2, 0.2, 0.2);
                 
-                float r = texture(screenTexture, uv + offsetR).r;
-                float g = texture(screenTexture, uv).g;
-                float b = texture(screenTexture, uv + offsetB).b;
+                // specular 
+                vec3 viewDir = normalize(viewPos[Eye].xyz - FragPos);
+                vec3 reflectDir = reflect(-lightDir, norm);
+                float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+                vec3 specular = spec * vec3(0.5);
                 
-                FragColor = vec4(r, g, b, 1.0);
-            } 
-            else 
-            {
-                FragColor = texture(screenTexture, uv);
+                FragColor = vec4(ambient + diffuse + specular, 1.0) * texColor;
+            } else {
+                FragColor = texColor;
             }
         }
     )";
 
+// distortion fragment shader variant for a single-sample scene color
+const char* distortionSingleSampleHeader = R"(
+        #define SCENE_SINGLE_SAMPLE
+    )";
+
+// warp mesh (DistortionMesh) over the eyes' parts of the window
+const char* distortionVertexShader = R"(
+        #version 430 core
+        layout (location = 0) in vec2 aPos; // in the eye's image, [0, 1]
+        layout (location = 1) in float aEye;
+        
+        // per channel of this panel point: xy where the lens looks in the eye's image,
+        // zw the same point in the rendered scene after the timewarp
+        out vec4 Scene[3];
+        flat out int Eye;
+        
+        // inverse lens mapping (LensLut), scene minus panel coordinates, layer eye * 3 + channel.
+        // Read per vertex, the mapping is smooth enough to interpolate across a mesh cell
+        uniform sampler2DArray lensTexture;
+        
+        layout (std140, binding = 6) uniform TimewarpBlock {
+            mat4 u_timewarp[2];
+        };
+        
+        // eye image coordinates seen with the latest head rotation to those of the rendered
+        // scene. Per vertex like the lens, behind the rendered view (w <= 0) lands outside it
+        vec2 timewarp(vec2 uv) {
+            vec3 h = mat3(u_timewarp[Eye]) * vec3(uv * 2.0 - 1.0, 1.0);
+            return h.z > 0.0 ? h.xy / h.z * 0.5 + 0.5 : vec2(-1.0);
+        }
+        
+        void main() {
+            // the eye's part of the window, the left eye goes left / on top
+            Eye = int(aEye);
+            vec2 position = aPos;
+            if (u_stereoLayout == 1)
+                position.x = (position.x + float(Eye)) * 0.5;
+            else if (u_stereoLayout == 2)
+                position.y = (position.y + float(1 - Eye)) * 0.5;
+            gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+            for (int channel = 0; channel < 3; ++channel) {
+                vec2 uv = aPos;
+                if (u_b_applyDistortion)
+                    uv += textureLod(lensTexture, vec3(aPos, Eye * 3 + channel), 0.0).rg;
+                Scene[channel] = vec4(uv, timewarp(uv));
+            }
+        }
+    )";
+
+const char* distortionFragmentShader = R"(
+        #version 430 core
+        in vec4 Scene[3];
+        flat in int Eye;
+        out vec4 FragColor;
+        
+        // multisample scene color, one layer per eye, resolved here instead of in a separate
+        // pass. Without MSAA (distortionSingleSampleHeader) plain filtered reads
+        #ifdef SCENE_SINGLE_SAMPLE
+        uniform sampler2DArray screenTexture;
+        
+        float sceneChannel(vec2 uv, int channel) {
+            return texture(screenTexture, vec3(uv, Eye))[channel];
+        }
+        #else
+        uniform sampler2DMSArray screenTexture;
+        
+        // box filter over the samples of one texel, edges clamped like a sampler would
+        vec4 resolveTexel(ivec2 texel) {
+            texel = clamp(texel, ivec2(0), textureSize(screenTexture).xy - 1);
+            vec4 color = vec4(0.0);
+            for (int i = 0; i < u_sceneSamples; ++i)
+                color += texelFetch(screenTexture, ivec3(texel, Eye), i);
+            return color / float(u_sceneSamples);
+        }
+        
+        // one channel of the scene at target coordinates: bilinear between resolved texels,
+        // the scene is resampled by the lens and upscaled at a reduced render scale, or the
+        // nearest texel's samples alone for a quarter of the fetches
+        float sceneChannel(vec2 uv, int channel) {
+            vec2 position = uv * vec2(textureSize(screenTexture).xy) - 0.5;
+            if (!u_sceneBilinear)
+                return resolveTexel(ivec2(floor(position + 0.5)))[channel];
+            ivec2 texel = ivec2(floor(position));
+            vec2 f = position - vec2(texel);
+            vec4 bottom = mix(resolveTexel(texel), resolveTexel(texel + ivec2(1, 0)), f.x);
+            vec4 top = mix(resolveTexel(texel + ivec2(0, 1)), resolveTexel(texel + ivec2(1, 1)), f.x);
+            return mix(bottom, top, f.y)[channel];
+        }
+        #endif
+        
+        // eye image coordinates to the multi-resolution scene target, linear within each
+        // of the 3x3 cells: the middle cells' line, bent at the fovea edges. Per fragment,
+        // the kinks fall inside warp mesh cells and interpolating across them is pixels off
+        vec2 multiResTarget(vec2 uv) {
+            return uv * u_multiResMiddle.xy + u_multiResMiddle.zw
+                + min(uv - u_multiResViewEdges.xy, 0.0) * u_multiResSlopes.xy
+                + max(uv - u_multiResViewEdges.zw, 0.0) * u_multiResSlopes.zw;
+        }
+        
+        bool outsideImage(vec2 uv) {
+            return any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0)));
+        }
+        
+        // one channel of the scene seen through the lens here. Black where the lens looks
+        // past the eye's field of view, or the timewarp past the rendered scene
+        float lensChannel(int channel) {
+            vec4 scene = Scene[channel];
+            if (outsideImage(scene.xy) || outsideImage(scene.zw))
+                return 0.0;
+            return sceneChannel(multiResTarget(scene.zw), channel);
+        }
+        
+        void main() {
+            // Chromatic aberration comes with the per-channel lens mapping
+            FragColor = vec4(lensChannel(0), lensChannel(1), lensChannel(2), 1.0);
+        }
+    )";
+
 
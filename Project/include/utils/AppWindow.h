@@ -0,0 +1,69 @@
+#pragma once
+#include <memory>
+#include <string>
+
+// how the app window / headless context is set up, see parseAppWindowArguments
+struct AppWindowDesc {
+    int width = 1200;
+    int height = 800;
+    std::string title = "VR Scene";
+    int frameCount = 0;          // close after this many frames, 0 runs until closed (headless: 1 frame)
+    // headless only
+    std::string inputScript;     // scripted keys, mouse buttons, cursor and scroll per frame
+    std::string outputPath;      // binary PPM of the last frame, a %d in the path writes every frame
+    double fixedTimeStep = 0.0;  // seconds per frame instead of the clock, for reproducible frames
+};
+
+// --size WxH, --frames N, --script file, --output file.ppm, --fixed-step seconds;
+// false (and a message) on an unknown or incomplete argument
+bool parseAppWindowArguments(int argc, char** argv, AppWindowDesc& desc);
+
+// The window, GL context and input of the app. The default build opens a GLFW
+// window (AppWindow.cpp). Built with VR_HEADLESS, an EGL context on the surfaceless
+// Mesa platform renders into an offscreen framebuffer, input comes from a script
+// and the frames can be written out (HeadlessWindow.cpp): no display server needed.
+// Key and mouse button codes are the GLFW_KEY_* / GLFW_MOUSE_BUTTON_* values in both.
+class AppWindow
+{
+public:
+    using FramebufferSizeCallback = void (*)(int width, int height);
+    using CursorPosCallback = void (*)(double x, double y);
+    using ScrollCallback = void (*)(double offset);
+
+    AppWindow();
+    ~AppWindow();
+
+    AppWindow(const AppWindow&) = delete;
+    AppWindow& operator=(const AppWindow&) = delete;
+
+    // creates the context, makes it current and loads the GL functions
+    bool Create(const AppWindowDesc& desc);
+    // the context goes away, GL objects have to be released before
+    void Destroy();
+
+    bool ShouldClose() const;
+    void SetShouldClose(bool close);
+    void SetTitle(const std::string& title);
+
+    void SwapBuffers();
+    // callbacks run from here
+    void PollEvents();
+
+    bool IsKeyDown(int key) const;
+    bool IsMouseButtonDown(int button) const;
+    // seconds since Create
+    double GetTime() const;
+    void GetFramebufferSize(int& width, int& height) const;
+    // framebuffer the last pass draws into, 0 for the window's
+    unsigned int GetBackbuffer() const;
+    // GL entry points glad does not load (extensions), null when missing
+    void* GetProcAddress(const char* name) const;
+
+    void SetFramebufferSizeCallback(FramebufferSizeCallback callback);
+    void SetCursorPosCallback(CursorPosCallback callback);
+    void SetScrollCallback(ScrollCallback callback);
+
+private:
+    struct Backend;
+    std::unique_ptr<Backend> mBackend;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <vector>
+
+// bicubic bezier patch of the ring screen, controlPoints[i][j]: i along the arc (u), j along the height (v)
+
+// control points of a ring section with the given radius, height and arc angle (radians)
+void GenerateControlPoints4x4(glm::vec3 controlPoints[4][4],
+    float R = 2.0f, float H = 1.0f, float angle = glm::half_pi<float>());
+
+// flat panel with the same width as the ring section of radius R and arc angle, for morphing
+void GenerateFlatControlPoints4x4(glm::vec3 controlPoints[4][4],
+    float R = 2.0f, float H = 1.0f, float angle = glm::half_pi<float>());
+
+// local space bounding box of the exact ring section (cylinder axis along y through (0, *, R))
+void RingScreenBounds(glm::vec3& boxMin, glm::vec3& boxMax,
+    float R = 2.0f, float H = 1.0f, float angle = glm::half_pi<float>());
+
+// local space bounding box of a bicubic patch, analytic: the surface lies in the
+// convex hull of its control points, so their box bounds it
+void BezierPatchBounds(const glm::vec3 cp[4][4], glm::vec3& boxMin, glm::vec3& boxMax);
+
+float bernstein(int i, float t);
+float bernsteinDeriv(int i, float t);
+
+glm::vec3 bezierSurfacePoint(const glm::vec3 cp[4][4], float u, float v);
+glm::vec3 bezierSurfaceTangentU(const glm::vec3 cp[4][4], float u, float v);
+glm::vec3 bezierSurfaceTangentV(const glm::vec3 cp[4][4], float u, float v);
+
+// Arc length reparameterization of the patch along u (the arc), measured on the
+// v = 0.5 curve. Bezier u is not proportional to arc length, rows placed at
+// Parameter(k / segments) are evenly spaced along the screen
+class ArcLengthTable
+{
+public:
+    void Build(const glm::vec3 controlPoints[4][4], int samples = 256);
+    bool IsBuilt() const noexcept { return !mInverse.empty(); }
+
+    // bezier u at arc length fraction s, from the precomputed inverse table
+    float Parameter(float s) const;
+    // arc length fraction at bezier u
+    float ArcFraction(float u) const;
+    float Length() const noexcept { return mLength; }
+
+private:
+    static float lookup(const std::vector<float>& table, float x);
+
+private:
+    std::vector<float> mForward; // arc fraction at u = k / samples
+    std::vector<float> mInverse; // u at arc fraction k / samples
+    float mLength = 0.0f;
+};
+
+// Texels per degree across the screen seen from viewPoint and texels per unit of
+// screen length for a textureWidth wide desktop stream, bezier u vs arc length
+// texture coordinates, and the stream width the arc length mapping needs for the
+// same minimum density
+void printScreenTexelDensityReport(const glm::vec3 controlPoints[4][4], const glm::vec3& viewPoint, int textureWidth);
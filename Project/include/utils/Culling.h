@@ -0,0 +1,52 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+
+struct AABB {
+    glm::vec3 min{ 0.0f };
+    glm::vec3 max{ 0.0f };
+};
+
+struct BoundingSphere {
+    glm::vec3 center{ 0.0f };
+    float radius = 0.0f;
+};
+
+// bounds of interleaved float vertices, position first, strideFloats floats per vertex.
+// The sphere is centered on the box and reaches the farthest vertex, tighter than the box corner
+void computeBounds(const float* vertices, size_t vertexCount, size_t strideFloats, AABB& box, BoundingSphere& sphere);
+// box around both
+AABB mergeBounds(const AABB& a, const AABB& b);
+// world box of a local box under model, still axis aligned (Arvo)
+AABB transformBounds(const AABB& box, const glm::mat4& model);
+BoundingSphere transformBounds(const BoundingSphere& sphere, const glm::mat4& model);
+
+// objects of one frame's culling
+struct CullStats {
+    int visible = 0;
+    int culled = 0;
+};
+
+// The six planes of a view-projection matrix, tested with SSE where available.
+// The planes are kept structure-of-arrays, padded to eight, so one box goes
+// against four planes per instruction, and four spheres against one plane.
+class Frustum
+{
+public:
+    // GL clip space, plane normals point inwards
+    void Extract(const glm::mat4& viewProjection);
+
+    bool IsVisible(const AABB& box) const;
+    bool IsVisible(const BoundingSphere& sphere) const;
+
+    // visible[i] = 1 or 0 for every object, returns the visible count
+    int CullBoxes(const AABB* boxes, size_t count, unsigned char* visible) const;
+    int CullSpheres(const BoundingSphere* spheres, size_t count, unsigned char* visible) const;
+
+private:
+    // x, y, z, w of planes 0..5, 6 and 7 repeat plane 0
+    alignas(16) float mPlaneX[8];
+    alignas(16) float mPlaneY[8];
+    alignas(16) float mPlaneZ[8];
+    alignas(16) float mPlaneW[8];
+};
@@ -1,6 +1,15 @@
 #pragma once
 #include <glm/glm.hpp>
 
+// views of a stereo camera, kMonoEye is the camera itself
+enum StereoEye { kMonoEye = -1, kLeftEye = 0, kRightEye = 1 };
+
+// Rotational timewarp of an image rendered with renderRotation (a world to view rotation)
+// shown for latestRotation: the homography from normalized device coordinates of the
+// latest view to those of the rendered image, both through projection. Upper left 3x3
+// of the result, (x, y, 1) in and divide by z out; a mat4 to fit std140 blocks
+glm::mat4 timewarpMatrix(const glm::mat3& renderRotation, const glm::mat3& latestRotation, const glm::mat4& projection);
+
 //Custom camera class
 class CustomCamera
 {
@@ -17,8 +26,25 @@ public:
     void SetZoom(float val);
     float GetZoom() const noexcept;
 
+    glm::vec3 GetFront() const noexcept;
+    // world to view rotation, the same for every eye (their view axes are parallel)
+    glm::mat3 GetViewRotation() const;
+
     glm::mat4 GetViewMatrix();
 
+    // Stereo: the eyes sit ipd apart along the right vector with parallel view axes,
+    // their off-axis frusta meet at the convergence distance (zero parallax there)
+    void SetIpd(float val);
+    float GetIpd() const noexcept;
+    void SetConvergence(float val);
+    float GetConvergence() const noexcept;
+    glm::vec3 GetEyePosition(StereoEye eye) const;
+    glm::mat4 GetEyeViewMatrix(StereoEye eye) const;
+    // glm::perspective(radians(zoom), aspect, ...) for kMonoEye, sheared towards the other eye otherwise
+    glm::mat4 GetEyeProjectionMatrix(StereoEye eye, float aspect, float zNear, float zFar) const;
+    // world space ray through a point in normalized device coordinates, (0, 0) is the gaze ray
+    void GetRay(float ndcX, float ndcY, float aspect, glm::vec3& origin, glm::vec3& direction) const;
+
     void ProcessKeyboard(int direction, float deltaTime);
     void ProcessMouseMovement(float xoffset, float yoffset, bool constrainPitch = true);
     void ProcessMouseScroll(float yoffset);
@@ -40,6 +66,9 @@ private:
     float mMovementSpeed;
     float mSensitivity;
     float mZoom;
+
+    float mIpd;
+    float mConvergence;
 };
 
 
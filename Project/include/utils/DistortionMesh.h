@@ -0,0 +1,47 @@
+#pragma once
+#include "utils/GLObject.h"
+#include <glm/glm.hpp>
+#include <functional>
+
+// one warp mesh vertex, a point of the eye's image in [0, 1]
+struct WarpVertex {
+    glm::vec2 position;
+    float eye; // 0 left / mono, 1 right
+    float padding;
+};
+
+// whether the lens shows any of the scene at position of an eye's image
+using LensCoverage = std::function<bool(int eye, glm::vec2 position)>;
+
+// The distortion pass's geometry: a grid per eye over the eye's part of the window.
+// The vertex shader reads the lens mapping from the LensLut at the grid's corners and
+// the cells interpolate it. Besides the full grid the mesh holds the cells the lens
+// shows part of the scene through, the black border around them is never rasterized.
+class DistortionMesh
+{
+public:
+    DistortionMesh() = default;
+
+    DistortionMesh(const DistortionMesh&) = delete;
+    DistortionMesh& operator=(const DistortionMesh&) = delete;
+
+    // columns x rows quads per eye, for both eyes. A cell is kept for the lens
+    // when covered holds at one of its or its neighbours' corners
+    void Build(int columns, int rows, const LensCoverage& covered);
+    // the first eyeCount eyes' grids in one draw, only the cells the lens shows or all of them
+    void Draw(int eyeCount, bool lensCells) const;
+
+    int GetCellsPerEye() const noexcept { return mIndicesPerEye / 6; }
+    // cells kept for the lens, both eyes
+    int GetLensCellCount() const noexcept { return (mLensIndices[0] + mLensIndices[1]) / 6; }
+
+    // delete the buffers, has to run while the context is current
+    void Release();
+
+private:
+    GLVertexArray mVertexArray;
+    GLBuffer mVertexBuffer;
+    GLBuffer mIndexBuffer;
+    int mIndicesPerEye = 0;
+    int mLensIndices[2] = {};
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+// Offscreen render scale against a GPU frame time budget. The scale moves in
+// fixed steps between min and max: one step down after a few frames over the
+// budget, one step up only after a long run comfortably under it. The gap
+// between the two thresholds keeps it from oscillating around the budget and
+// the render targets from being reallocated every frame.
+class DynamicResolution
+{
+public:
+    DynamicResolution(float budgetMs = 1000.0f / 90.0f, float minScale = 0.5f, float maxScale = 1.0f);
+
+    // feed one measured GPU frame time, returns true when the scale changed
+    bool Update(float gpuMs);
+
+    float GetScale() const noexcept { return mScale; }
+    // smoothed GPU frame time
+    float GetAverageMs() const noexcept { return mAverageMs; }
+    float GetBudgetMs() const noexcept { return mBudgetMs; }
+
+    // scale change per step
+    static constexpr float kStep = 0.1f;
+    // over kDownLoad of the budget for kDownFrames frames: step down
+    static constexpr float kDownLoad = 0.95f;
+    static constexpr int kDownFrames = 3;
+    // under kUpLoad of the budget for kUpFrames frames: step up
+    static constexpr float kUpLoad = 0.75f;
+    static constexpr int kUpFrames = 45;
+
+private:
+    float mBudgetMs;
+    float mMinScale;
+    float mMaxScale;
+    float mScale;
+    float mAverageMs = 0.0f;
+    int mOverFrames = 0;
+    int mUnderFrames = 0;
+};
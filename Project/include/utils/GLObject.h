@@ -0,0 +1,86 @@
+#pragma once
+
+// kinds of GL objects owned through GLObject
+enum class GLObjectType {
+    Texture,
+    Buffer,
+    VertexArray,
+    Framebuffer,
+    Renderbuffer,
+    Program,
+    Count
+};
+
+// glGen*/glCreateProgram and glDelete* for one object of type
+unsigned int createGLObject(GLObjectType type);
+void deleteGLObject(GLObjectType type, unsigned int id);
+
+// Live GL object counters, fed by every GLObject
+class GLObjectTracker
+{
+public:
+    static void OnCreate(GLObjectType type);
+    static void OnDestroy(GLObjectType type);
+
+    static int LiveCount(GLObjectType type);
+    // all types
+    static int LiveCount();
+    static const char* TypeName(GLObjectType type);
+
+    // print every type that still has live objects, returns true when nothing leaked
+    static bool ReportLeaks();
+};
+
+// Move-only owner of one GL object, deleted when the owner goes away.
+// The GL context has to be current whenever an owner is destroyed
+template <GLObjectType Type>
+class GLObject
+{
+public:
+    GLObject() = default;
+    // adopt an object created elsewhere (createShaderProgram, createProxyCube, ...)
+    explicit GLObject(unsigned int id) : mId(id)
+    {
+        if (mId)
+            GLObjectTracker::OnCreate(Type);
+    }
+    ~GLObject() { Reset(); }
+
+    GLObject(const GLObject&) = delete;
+    GLObject& operator=(const GLObject&) = delete;
+
+    GLObject(GLObject&& other) noexcept : mId(other.mId) { other.mId = 0; }
+    GLObject& operator=(GLObject&& other) noexcept
+    {
+        if (this != &other) {
+            Reset();
+            mId = other.mId;
+            other.mId = 0;
+        }
+        return *this;
+    }
+
+    static GLObject Create() { return GLObject(createGLObject(Type)); }
+
+    unsigned int Get() const noexcept { return mId; }
+    explicit operator bool() const noexcept { return mId != 0; }
+
+    void Reset()
+    {
+        if (mId) {
+            deleteGLObject(Type, mId);
+            GLObjectTracker::OnDestroy(Type);
+            mId = 0;
+        }
+    }
+
+private:
+    unsigned int mId = 0;
+};
+
+using GLTexture = GLObject<GLObjectType::Texture>;
+using GLBuffer = GLObject<GLObjectType::Buffer>;
+using GLVertexArray = GLObject<GLObjectType::VertexArray>;
+using GLFramebuffer = GLObject<GLObjectType::Framebuffer>;
+using GLRenderbuffer = GLObject<GLObjectType::Renderbuffer>;
+using GLProgram = GLObject<GLObjectType::Program>;
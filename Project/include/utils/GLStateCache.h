@@ -0,0 +1,47 @@
+#pragma once
+#include "utils/GLObject.h"
+#include <cstddef>
+
+// state changes of one frame
+struct GLStateStats {
+    int submitted = 0; // passed on to GL
+    int filtered = 0;  // dropped, GL was already in that state
+};
+
+// Thin layer in front of the GL binding state: program, texture units, vertex
+// array, framebuffers, buffers and capabilities all change through here, the
+// functions mirror their gl* counterparts. A call that would leave GL in the
+// state it is already in is dropped. Code that changes this state behind the
+// cache's back has to call Invalidate() afterwards.
+class GLStateCache
+{
+public:
+    static void UseProgram(unsigned int program);
+    // GL_TEXTURE0 + unit
+    static void ActiveTexture(unsigned int texture);
+    // on the active unit
+    static void BindTexture(unsigned int target, unsigned int texture);
+    // also resets the cached element array buffer, it is vertex array state
+    static void BindVertexArray(unsigned int vertexArray);
+    // GL_FRAMEBUFFER sets the draw and the read framebuffer
+    static void BindFramebuffer(unsigned int target, unsigned int framebuffer);
+    static void BindBuffer(unsigned int target, unsigned int buffer);
+    // indexed uniform / shader storage bindings, also set the generic binding of target
+    static void BindBufferBase(unsigned int target, unsigned int index, unsigned int buffer);
+    static void BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer,
+        std::ptrdiff_t offset, std::ptrdiff_t size);
+
+    static void Enable(unsigned int capability);
+    static void Disable(unsigned int capability);
+    static void CullFace(unsigned int mode);
+    static void DepthFunc(unsigned int func);
+
+    // forget everything, the next call of each kind goes to GL again
+    static void Invalidate();
+    // deleting a bound object sets its bindings back to 0, called by deleteGLObject
+    static void OnDelete(GLObjectType type, unsigned int id);
+
+    // start counting a new frame, the finished one is kept for GetFrameStats()
+    static void BeginFrame();
+    static GLStateStats GetFrameStats();
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include <functional>
+#include <vector>
+
+// GPU time of iterations calls of work in ms per call, measured with a
+// GL_TIME_ELAPSED query. Blocks until the result is available, for one-off benchmarks
+float measureGpuTime(const std::function<void()>& work, int iterations = 1);
+
+// Per-frame GPU time from GL_TIMESTAMP queries at the start and end of the frame.
+// The results are picked up frames later, once available, so the timer never
+// stalls the pipeline, and it may enclose GL_TIME_ELAPSED queries like measureGpuTime
+class GpuFrameTimer
+{
+public:
+    // latency: frames in flight before a result has to be there, older ones are dropped
+    explicit GpuFrameTimer(int latency = 4);
+    ~GpuFrameTimer();
+
+    GpuFrameTimer(const GpuFrameTimer&) = delete;
+    GpuFrameTimer& operator=(const GpuFrameTimer&) = delete;
+
+    void Begin();
+    void End();
+    // newest finished frame in ms, false when no new result arrived
+    bool Poll(float& ms);
+
+    // delete the queries, has to run while the context is current
+    void Release();
+
+private:
+    std::vector<unsigned int> mQueries; // start and end per slot
+    std::vector<bool> mPending;
+    int mWriteSlot = 0;
+    int mReadSlot = 0;
+};
+
+// Motion-to-photon estimate: from the CPU time an input was sampled to the GPU
+// finishing the frame that showed it. A GL_TIMESTAMP query after the swap marks
+// completion and is read back frames later, like GpuFrameTimer. The GPU clock is
+// mapped onto the CPU clock by reading both at the same moment on every Mark
+class InputLatencyMeter
+{
+public:
+    explicit InputLatencyMeter(int latency = 4);
+    ~InputLatencyMeter();
+
+    InputLatencyMeter(const InputLatencyMeter&) = delete;
+    InputLatencyMeter& operator=(const InputLatencyMeter&) = delete;
+
+    // right after the swap; inputTime and cpuNow in seconds of the same CPU clock
+    void Mark(double inputTime, double cpuNow);
+    // newest finished frame in ms, false when no new result arrived
+    bool Poll(float& ms);
+
+    // delete the queries, has to run while the context is current
+    void Release();
+
+private:
+    std::vector<unsigned int> mQueries;
+    std::vector<double> mInputTimes;
+    std::vector<bool> mPending;
+    int mWriteSlot = 0;
+    int mReadSlot = 0;
+    double mGpuToCpu = 0.0; // seconds to add to a GPU timestamp
+};
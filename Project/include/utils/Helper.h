@@ -1,20 +1,72 @@
 #pragma once
+#include <string>
 #include <vector>
 #include <glm/gtc/type_ptr.hpp>
+#include "utils/MeshCache.h"
+#include "utils/VertexFormat.h"
+
+class ArcLengthTable;
+class SceneBatch;
 
 // Compile shaders
 unsigned int compileShader(unsigned int type, const char* source);
 // create shader program
 unsigned int createShaderProgram(const char* vertexSource, const char* fragmentSource);
+// source with header spliced in after its #version line: #extension and #define lines of a variant
+std::string shaderVariant(const char* source, const char* header);
+// whether the current context lists the extension (GL_ARB_..., GL_OVR_...)
+bool hasGLExtension(const char* name);
 
-// create full screen
-void createQuad(unsigned int& quadVAO, unsigned int& quadVBO);
+// unit cube [-1, 1]^3 as 36 vertices (position only), proxy geometry for ray-cast surfaces
+void createProxyCube(unsigned int& cubeVAO, unsigned int& cubeVBO);
 
 void createRingScreenWithBezier(
        /*glm::vec3 controlPoints[4][4],*/ 
         int segmentsU, int segmentsV,
         std::vector<float>& vertices,
         std::vector<unsigned int>& indices);
+// tessellate the given bicubic control points, vertices are interleaved pos/normal/uv.
+// With an arc length table rows are placed at even arc length and u is the arc fraction
+void createRingScreenWithBezier(
+        const glm::vec3 controlPoints[4][4],
+        int segmentsU, int segmentsV,
+        std::vector<float>& vertices,
+        std::vector<unsigned int>& indices,
+        const ArcLengthTable* arcLength = nullptr);
+// Evaluate grid rows [rowBegin, rowEnd) straight into vertices (the base of the
+// whole grid), packed in layout. Rows are independent, so ranges can run on
+// different threads
+void tessellateRingScreenRows(
+        const glm::vec3 controlPoints[4][4],
+        int segmentsU, int segmentsV, VertexLayout layout,
+        int rowBegin, int rowEnd,
+        unsigned char* vertices,
+        const ArcLengthTable* arcLength = nullptr);
+
+// Grid triangle indices, emitted in column bands of bandWidth quads (0 = plain row order)
+void writeRingScreenIndices(int segmentsU, int segmentsV, int bandWidth, unsigned int* indices);
+void writeRingScreenIndices(int segmentsU, int segmentsV, int bandWidth, unsigned short* indices);
+
+// band width that fits two band rows into a 16 entry FIFO cache
+const int kRingScreenIndexBand = 7;
+
+// Zero-copy tessellation: map the draw's range of the batch's own buffers and fill it
+// from several threads, no host side vertex copy. The draw is reserved for
+// (segmentsU + 1) * (segmentsV + 1) vertices and segmentsU * segmentsV * 6 indices
+bool createRingScreenMapped(
+        const glm::vec3 controlPoints[4][4],
+        int segmentsU, int segmentsV,
+        SceneBatch& batch, int draw,
+        const ArcLengthTable* arcLength = nullptr);
+
+// (u,v) grid of the screen as unorm16 pairs, positions are evaluated in the vertex shader
+void createRingScreenUVGrid(
+        int segmentsU, int segmentsV,
+        std::vector<unsigned short>& uvs,
+        std::vector<unsigned int>& indices);
+
+// tessellate, reorder and pack the ring screen described by the cache key
+void buildRingScreenMesh(const MeshCacheKey& key, MeshBlobs& mesh);
 
 void generateDynamicTextureData(std::vector<unsigned char>& data, int width, int height);
 void updateDynamicTexture(unsigned int textureID);
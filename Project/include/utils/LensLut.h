@@ -0,0 +1,37 @@
+#pragma once
+#include "utils/GLObject.h"
+#include "utils/LensProfile.h"
+
+// The inverse lens mapping solved once per texel into an RG16F array texture,
+// layer eye * 3 + channel. A texel holds the scene coordinates minus the panel
+// coordinates (small, so half floats keep them precise), the distortion vertex
+// shader fetches them per channel at the warp mesh's corners. Panel positions without a
+// solution get an offset that lands far outside the scene.
+class LensLut
+{
+public:
+    LensLut() = default;
+
+    LensLut(const LensLut&) = delete;
+    LensLut& operator=(const LensLut&) = delete;
+
+    // solve size x size texels per eye and channel and upload them
+    void Build(const LensProfile& profile, int size);
+
+    unsigned int GetTexture() const noexcept { return mTexture.Get(); }
+    // Self-check of the last Build against the analytic model: the stored half
+    // float coordinates run forward through the lens again. Largest distance to
+    // the texel's panel position over the solved texels, in [0, 1] image coordinates
+    float GetMaxRoundTripError() const noexcept { return mMaxRoundTripError; }
+    // texels of the last Build without a solution, they stay black
+    int GetUnsolvedCount() const noexcept { return mUnsolvedCount; }
+
+    // delete the texture, has to run while the context is current
+    void Release();
+
+private:
+    GLTexture mTexture;
+    int mSize = 0;
+    float mMaxRoundTripError = 0.0f;
+    int mUnsolvedCount = 0;
+};
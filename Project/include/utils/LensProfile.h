@@ -0,0 +1,39 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// Calibrated radial model of an HMD eyepiece (Brown-Conrady, radial terms only).
+// Coordinates are in the eye's image, [-1, 1] on both axes, relative to the lens
+// center. The scene seen at radius r through the lens comes from the panel at
+//   channelScale[c] * r * (1 + k1 r^2 + k2 r^4 + k3 r^6)
+// for color channel c, so a pincushion lens has negative terms (the panel image
+// is barrel shaped) and lateral chromatic aberration is a per-channel scale
+struct LensProfile {
+    std::string name;
+    float k1 = 0.0f;
+    float k2 = 0.0f;
+    float k3 = 0.0f;
+    glm::vec3 channelScale = glm::vec3(1.0f); // red, green, blue
+    // lens center right of the left eye's image center, mirrored for the right eye
+    float centerOffset = 0.0f;
+};
+
+// the profile used when no lens file can be read
+LensProfile defaultLensProfile();
+
+// Lines of "name k1 k2 k3 scaleRed scaleGreen scaleBlue [centerOffset]", # starts a comment.
+// Appends to profiles; false (and a message) when the file cannot be opened or a line is bad
+bool loadLensProfiles(const std::string& path, std::vector<LensProfile>& profiles);
+
+// lens center of an eye (0 left / mono, 1 right) in its image
+glm::vec2 lensCenter(const LensProfile& profile, int eye);
+// panel radius of the scene seen at radius through the lens
+float lensPanelRadius(const LensProfile& profile, int channel, float radius);
+// Inverse of lensPanelRadius by Newton iteration: the radius seen through the lens
+// for a panel radius. False beyond the fold of the polynomial, where no radius maps there
+bool lensViewRadius(const LensProfile& profile, int channel, float panelRadius, float& radius);
+
+// where channel of panel position (eye image coordinates in [0, 1]) reads the scene;
+// false when the lens shows nothing of the scene there
+bool lensSceneCoordinates(const LensProfile& profile, int eye, int channel, glm::vec2 position, glm::vec2& scene);
@@ -0,0 +1,106 @@
+#pragma once
+#include "utils/VertexFormat.h"
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Versioned binary cache of tessellated bezier meshes.
+// File = MeshCacheHeader | vertex blob | index blob, the blobs are stored exactly
+// as uploaded (packed vertices, 16/32-bit indices) so a mapped file feeds glBufferData directly.
+
+const uint32_t kMeshCacheVersion = 1;
+
+// MeshCacheKey::flags
+const uint32_t kMeshFlagOptimizeVertexCache = 1u << 0;
+const uint32_t kMeshFlagOptimizeVertexFetch = 1u << 1;
+const uint32_t kMeshFlagArcLengthUV = 1u << 2;
+
+// everything the tessellated mesh depends on
+struct MeshCacheKey {
+    glm::vec3 controlPoints[4][4];
+    int degree = 3;
+    int segmentsU = 0;
+    int segmentsV = 0;
+    VertexLayout layout = VertexLayout::Float32;
+    uint32_t flags = 0; // generator options (index/vertex reordering, arc length u, ...)
+
+    uint64_t Hash() const;
+};
+
+struct MeshCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t keyHash;
+    uint64_t contentHash; // hash of the vertex and index blobs
+    uint32_t layout;
+    uint32_t indexType;   // GL_UNSIGNED_SHORT / GL_UNSIGNED_INT
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint64_t vertexBytes;
+    uint64_t indexBytes;
+};
+
+// mesh blobs as uploaded to the vertex / index buffers
+struct MeshBlobView {
+    const void* vertexData = nullptr;
+    size_t vertexBytes = 0;
+    size_t vertexCount = 0;
+    const void* indexData = nullptr;
+    size_t indexBytes = 0;
+    size_t indexCount = 0;
+    unsigned int indexType = 0;
+};
+
+// CPU built mesh blobs, used when there is no valid cache file
+struct MeshBlobs {
+    std::vector<unsigned char> vertices;
+    std::vector<unsigned char> indices;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    unsigned int indexType = 0;
+
+    MeshBlobView View() const;
+};
+
+// cache file name of the key, inside directory
+std::string meshCachePath(const std::string& directory, const std::string& name, const MeshCacheKey& key);
+
+// write the blobs, returns false if the file can't be written
+bool writeMeshCache(const std::string& path, const MeshCacheKey& key, const MeshBlobView& mesh);
+
+// Read-only memory mapping of a cache file. Open() fails on a missing file,
+// version/key mismatch or a content hash that doesn't match the blobs
+class MeshCacheFile
+{
+public:
+    MeshCacheFile() = default;
+    ~MeshCacheFile();
+    MeshCacheFile(const MeshCacheFile&) = delete;
+    MeshCacheFile& operator=(const MeshCacheFile&) = delete;
+
+    bool Open(const std::string& path, const MeshCacheKey& key);
+    void Close();
+    bool IsOpen() const noexcept { return mHeader != nullptr; }
+
+    const MeshCacheHeader& Header() const noexcept { return *mHeader; }
+    const void* VertexData() const noexcept;
+    const void* IndexData() const noexcept;
+    // views into the mapping, valid until Close()
+    MeshBlobView View() const;
+
+private:
+    bool map(const std::string& path);
+
+private:
+    const unsigned char* mData = nullptr;
+    size_t mSize = 0;
+    const MeshCacheHeader* mHeader = nullptr;
+#ifdef _WIN32
+    void* mFile = nullptr;
+    void* mMapping = nullptr;
+#endif
+};
+
+uint64_t fnv1a64(const void* data, size_t bytes, uint64_t hash = 14695981039346656037ull);
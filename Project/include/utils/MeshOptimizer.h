@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// post-transform vertex cache statistics of an indexed triangle list
+struct VertexCacheStats {
+    float acmr = 0.0f; // average cache miss ratio: transformed vertices per triangle (0.5 .. 3)
+    float atvr = 0.0f; // average transform to vertex ratio: transformed vertices per vertex (1 = ideal)
+};
+
+// Reorder triangles for post-transform cache locality (Forsyth, "Linear-Speed
+// Vertex Cache Optimisation"). Vertex data is not touched
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+// Reorder vertices into first-use order of the index list for pre-transform
+// fetch locality; indices are remapped accordingly
+void optimizeVertexFetch(std::vector<float>& vertices, size_t floatsPerVertex, std::vector<unsigned int>& indices);
+
+// Simulate a FIFO post-transform cache of cacheSize entries
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize = 16);
+
+// Convert indices to 16-bit whenever the vertex count fits, returns the GL index type
+unsigned int packIndices(const std::vector<unsigned int>& indices, size_t vertexCount, std::vector<unsigned char>& dst);
+
+// Upload indices to the bound GL_ELEMENT_ARRAY_BUFFER, as 16-bit whenever the
+// vertex count fits. Returns the index type to pass to glDrawElements
+unsigned int uploadIndexBuffer(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int usage);
+
+// Print ACMR/ATVR of the ring screen before/after optimization per segment count
+void printRingScreenCacheReport(const std::vector<int>& segmentCounts);
@@ -0,0 +1,47 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// Fixed foveated rendering as a 3x3 multi-resolution split of an eye's view.
+// The middle cell, foveaSize of the view's width and height around its center,
+// keeps the full pixel density; the outer cells get peripheryDensity of it,
+// the lens squeezes them on the panel anyway. The cells lie side by side in a
+// target smaller than the eye's image and are drawn with the eye's unchanged
+// projection, each through its own viewport and scissor. Eye image coordinates
+// map to the target piecewise linearly per axis, cut at the fovea edges.
+class MultiResLayout
+{
+public:
+    // split a width x height eye image
+    void Build(int width, int height, float foveaSize, float peripheryDensity);
+
+    // size of the target holding the cells
+    int GetWidth() const noexcept { return mCenter[0] + 2 * mOuter[0]; }
+    int GetHeight() const noexcept { return mCenter[1] + 2 * mOuter[1]; }
+    // shaded pixels against rendering the whole image at full density
+    float GetShadedFraction() const noexcept;
+
+    // viewport (x, y, width, height for glViewportIndexedf) that puts the cell's
+    // part of the view on its pixels, and the scissor (x, y, width, height) of
+    // those pixels. column, row in 0..2 from the bottom left
+    void GetCell(int column, int row, glm::vec4& viewport, glm::ivec4& scissor) const;
+    // clip space scale and offset that, in front of the eye's projection, narrows the
+    // view to the cell's part of it: the cell's frustum for culling
+    glm::mat4 GetCellCrop(int column, int row) const;
+
+    // fovea edges in eye image coordinates, (x0, y0, x1, y1) in [0, 1]
+    glm::vec4 GetViewEdges() const noexcept;
+    // Eye image coordinates uv to target coordinates without divides or selects:
+    //   uv * middle.xy + middle.zw + min(uv - x0y0, 0) * slopes.xy + max(uv - x1y1, 0) * slopes.zw
+    // middle is the middle cells' line, slopes the changes of slope at the lower and upper edges
+    void GetTargetMapping(glm::vec4& middle, glm::vec4& slopes) const;
+
+private:
+    // the cell's range of the view in [0, 1] and its pixels in the target, along axis
+    void getCellSpan(int axis, int index, float& viewBegin, float& viewEnd, int& pixelBegin, int& pixels) const;
+
+private:
+    int mFullSize[2] = {};
+    float mViewEdge[2] = {};   // lower fovea edge per axis, the upper one is 1 - edge
+    int mOuter[2] = {};        // pixels of an outer cell per axis
+    int mCenter[2] = {};       // pixels of the middle cell per axis
+};
@@ -0,0 +1,139 @@
+#pragma once
+#include "utils/GLObject.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+// transient attachment of the render graph
+struct AttachmentDesc {
+    unsigned int format = 0;      // GL internal format, GL_RGB8, GL_DEPTH24_STENCIL8, ...
+    float scale = 1.0f;           // of the graph's output size, when width/height are 0
+    int width = 0;                // fixed size
+    int height = 0;
+    int samples = 1;              // > 1 for a multisample texture, read with texelFetch
+    int layers = 0;               // > 0 for an array texture, attached layered (gl_Layer picks)
+};
+
+class RenderGraph;
+
+// what a pass reads and writes, and the code that records it
+struct RenderPassDesc {
+    std::string name;
+    std::vector<int> inputs;       // sampled attachments, written by earlier passes
+    std::vector<int> colorOutputs; // attachments, or RenderGraph::kBackbuffer alone
+    int depthOutput = -1;          // depth(-stencil) attachment, -1 for none
+    // > 1: array outputs are attached as GL_OVR_multiview views 0..viewCount-1, see SetMultiviewFunction
+    int viewCount = 0;
+    // runs with the pass's framebuffer bound and the viewport set to its size
+    std::function<void(const RenderGraph&)> execute;
+};
+
+// Declarative frame setup: every frame the passes name their inputs and outputs
+// and the graph does the rest. Passes run in the order they were added.
+// Compiling drops the passes that do not contribute to the back buffer or an
+// exported attachment, gives every transient attachment a texture from a pool
+// for the lifetime of its users only (attachments that never live at the same
+// time share one texture) and builds one framebuffer per pass. The compiled
+// result is kept as long as the declarations and the output size stay the same,
+// so a resize or a new pass recompiles, a steady frame does not.
+class RenderGraph
+{
+public:
+    // the default framebuffer
+    static const int kBackbuffer = -2;
+
+    // framebuffer kBackbuffer stands for, 0 unless there is no window (headless)
+    void SetBackbuffer(unsigned int framebuffer) { mBackbuffer = framebuffer; }
+    // glFramebufferTextureMultiviewOVR, glad does not load extensions; without it
+    // multiview passes get their array outputs attached layered
+    void SetMultiviewFunction(void* framebufferTextureMultiview) { mFramebufferTextureMultiview = framebufferTextureMultiview; }
+
+    // start declaring a frame for a window framebuffer of width x height
+    void BeginFrame(int width, int height);
+
+    int CreateAttachment(const std::string& name, const AttachmentDesc& desc);
+    int AddPass(const RenderPassDesc& desc);
+    // keep the writers of an attachment alive without a back buffer consumer (capture, readback)
+    void Export(int attachment);
+
+    // compiles when the declarations changed, then runs the live passes
+    void Execute();
+
+    // physical texture behind an attachment, valid while its users run
+    unsigned int GetTexture(int attachment) const;
+    // GL_TEXTURE_2D, GL_TEXTURE_2D_MULTISAMPLE for a multisample attachment, the _ARRAY
+    // versions with layers
+    unsigned int GetTextureTarget(int attachment) const;
+    // From a pass's execute: attach only this layer of its array outputs, for drawing
+    // one layer after the other where the vertex shader can't write gl_Layer.
+    // -1 (and the end of the pass) attaches all layers again
+    void SelectLayer(int layer) const;
+    void GetAttachmentSize(int attachment, int& width, int& height) const;
+
+    int GetOutputWidth() const noexcept { return mOutputWidth; }
+    int GetOutputHeight() const noexcept { return mOutputHeight; }
+    int GetLivePassCount() const noexcept;
+    int GetPooledTextureCount() const noexcept { return static_cast<int>(mPool.size()); }
+    int GetCompileCount() const noexcept { return mCompiles; }
+    // print passes, culling and the attachment to texture assignment of the last compile
+    void PrintSummary() const;
+
+    // delete textures and framebuffers, has to run while the context is current
+    void Release();
+
+private:
+    struct Attachment {
+        std::string name;
+        AttachmentDesc desc;
+        bool exported = false;
+    };
+
+    // compiled per attachment / pass, indices follow the declarations
+    struct AttachmentState {
+        int width = 0, height = 0;
+        int texture = -1; // pool entry
+        int firstUse = -1, lastUse = -1;
+    };
+
+    struct PassState {
+        bool live = false;
+        bool backbuffer = false;
+        GLFramebuffer framebuffer;
+        int width = 0, height = 0;
+    };
+
+    struct PooledTexture {
+        GLTexture texture;
+        unsigned int format = 0;
+        int width = 0, height = 0;
+        int samples = 1;
+        int layers = 0;
+        bool used = false;  // by the current compile
+        int busyUntil = -1; // last pass of the attachment holding it
+    };
+
+    std::string declarationKey() const;
+    void compile();
+    void cullPasses();
+    void assignTextures();
+    void buildFramebuffers();
+    // attachment to the bound framebuffer, layer -1 for all layers / the pass's views
+    void attach(unsigned int point, int attachment, const RenderPassDesc& pass, int layer) const;
+
+private:
+    std::vector<Attachment> mAttachments;
+    std::vector<RenderPassDesc> mPasses;
+
+    std::vector<AttachmentState> mAttachmentStates;
+    std::vector<PassState> mPassStates;
+    std::vector<PooledTexture> mPool;
+    std::string mCompiledKey;
+    int mCompiles = 0;
+
+    int mOutputWidth = 0;
+    int mOutputHeight = 0;
+    unsigned int mBackbuffer = 0;
+    void* mFramebufferTextureMultiview = nullptr;
+    int mRunningPass = -1;
+    mutable bool mLayerSelected = false;
+};
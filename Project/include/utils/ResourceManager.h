@@ -0,0 +1,58 @@
+#pragma once
+#include "utils/GLObject.h"
+#include "utils/VertexFormat.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// indexed mesh that is uploaded once and never changes
+struct StaticMesh {
+    GLVertexArray vao;
+    GLBuffer vbo;
+    GLBuffer ebo;
+    int indexCount = 0;
+    unsigned int indexType = 0; // GL_UNSIGNED_SHORT / GL_UNSIGNED_INT
+};
+
+// Owner of the scene's long-lived GL objects. Everything is created once at
+// startup and handed out as plain ids; Release() (or the destructor) deletes it
+// all, so it has to run while the context is still current.
+class ResourceManager
+{
+public:
+    ResourceManager() = default;
+    ~ResourceManager() { Release(); }
+
+    ResourceManager(const ResourceManager&) = delete;
+    ResourceManager& operator=(const ResourceManager&) = delete;
+
+    unsigned int CreateTexture();
+    unsigned int CreateBuffer();
+    unsigned int CreateVertexArray();
+    unsigned int CreateFramebuffer();
+    unsigned int CreateRenderbuffer();
+
+    // take ownership of objects made elsewhere (createShaderProgram, createProxyCube, ...)
+    unsigned int AdoptProgram(unsigned int program);
+    unsigned int AdoptVertexArray(unsigned int vertexArray);
+    unsigned int AdoptBuffer(unsigned int buffer);
+
+    // Upload a static mesh under name once, vertices are packed in layout.
+    // Later calls with the same name return the existing mesh
+    const StaticMesh& CreateStaticMesh(const std::string& name,
+        const void* vertices, size_t vertexCount, VertexLayout layout,
+        const std::vector<unsigned int>& indices);
+    const StaticMesh* FindStaticMesh(const std::string& name) const;
+
+    // delete everything, meshes first and programs last
+    void Release();
+
+private:
+    std::map<std::string, StaticMesh> mMeshes;
+    std::vector<GLVertexArray> mVertexArrays;
+    std::vector<GLBuffer> mBuffers;
+    std::vector<GLFramebuffer> mFramebuffers;
+    std::vector<GLRenderbuffer> mRenderbuffers;
+    std::vector<GLTexture> mTextures;
+    std::vector<GLProgram> mPrograms;
+};
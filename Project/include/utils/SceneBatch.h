@@ -0,0 +1,114 @@
+#pragma once
+#include "utils/GLObject.h"
+#include "utils/VertexFormat.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+// per-draw data of a SceneBatch, std430 in the draw data storage buffer
+struct DrawData {
+    glm::mat4 model;
+    glm::mat4 normalMatrix; // transpose(inverse(model)), upper 3x3
+    glm::vec4 color;        // rgb tint; a = 1 samples the screen texture, a = 0 is the tint alone
+};
+
+// Static scene geometry of one vertex layout, packed into shared vertex and
+// index buffers and drawn with a single glMultiDrawElementsIndirect. Indices are
+// relative to a draw's first vertex, so 16-bit indices hold every mesh of up to
+// 65536 vertices; the index type is picked from the largest mesh at construction.
+// Each draw gets a DrawData entry in a shader storage buffer. The shader finds
+// it through attribute 3, a per-instance draw index (divisor 1) that the
+// indirect command's baseInstance selects: gl_DrawID needs GL 4.6, this works on 4.3.
+// Submission cost is one call whatever the number of draws. For instanced stereo
+// every draw can go out several times, the draw index then advances per group of instances.
+class SceneBatch
+{
+public:
+    // indexType GL_UNSIGNED_SHORT or GL_UNSIGNED_INT. With GL 4.4 the vertex and index
+    // buffers are immutable and stay persistently mapped for writes
+    SceneBatch(VertexLayout layout, size_t maxVertices, size_t maxIndices, int maxDraws, unsigned int indexType);
+
+    SceneBatch(const SceneBatch&) = delete;
+    SceneBatch& operator=(const SceneBatch&) = delete;
+
+    // copy a mesh in, vertices in the batch's layout, indices of indexType are converted to
+    // the batch's on the way; returns the draw index, -1 when full
+    int Add(const void* vertices, size_t vertexCount, const void* indices, size_t indexCount,
+        unsigned int indexType, const DrawData& data);
+    int Add(const void* vertices, size_t vertexCount, const std::vector<unsigned int>& indices, const DrawData& data);
+    // a draw whose vertices and indices are written in place through Map
+    int Reserve(size_t vertexCount, size_t indexCount, const DrawData& data);
+
+    // Write access to a draw's vertices and indices (of GetIndexType). Free while the buffers
+    // are persistently mapped, otherwise the two ranges are mapped until Unmap. Only for
+    // draws the GPU is not reading yet
+    bool Map(int draw, unsigned char*& vertices, void*& indices);
+    void Unmap();
+
+    void SetDrawData(int draw, const DrawData& data);
+    // hidden draws stay in the batch with an instance count of 0
+    void SetVisible(int draw, bool visible);
+    bool IsVisible(int draw) const { return mCommands[draw].instanceCount != 0; }
+    // instances per visible draw (1, 2 for instanced stereo), gl_InstanceID tells them apart
+    // and all of them read the draw's DrawData
+    void SetInstanceCount(int instances);
+
+    // where a draw's vertices live, for in-place updates
+    unsigned int GetVertexBuffer() const noexcept { return mVertexBuffer.Get(); }
+    size_t GetVertexOffset(int draw) const;
+    VertexLayout GetLayout() const noexcept { return mLayout; }
+    unsigned int GetIndexType() const noexcept { return mIndexType; }
+
+    int GetDrawCount() const noexcept { return static_cast<int>(mCommands.size()); }
+
+    // upload changed draw data / commands and submit every draw, the draw data
+    // buffer is bound to drawDataBinding
+    void Draw(unsigned int drawDataBinding);
+
+    // delete the buffers, has to run while the context is current
+    void Release();
+
+private:
+    // glMultiDrawElementsIndirect command layout
+    struct DrawCommand {
+        unsigned int count;
+        unsigned int instanceCount;
+        unsigned int firstIndex;
+        int baseVertex;
+        unsigned int baseInstance;
+    };
+
+    int addDraw(size_t vertexCount, size_t indexCount, const DrawData& data);
+    // immutable persistently mapped storage when available, glBufferData otherwise
+    unsigned char* allocate(unsigned int target, size_t bytes, unsigned int usage);
+    // glBufferSubData, or a plain copy into the persistent mapping
+    void write(unsigned int buffer, unsigned char* mapped, size_t offset, size_t bytes, const void* data);
+    size_t indexSize() const noexcept;
+
+private:
+    VertexLayout mLayout;
+    size_t mMaxVertices;
+    size_t mMaxIndices;
+    int mMaxDraws;
+    unsigned int mIndexType;
+
+    GLVertexArray mVertexArray;
+    GLBuffer mVertexBuffer;
+    GLBuffer mIndexBuffer;
+    GLBuffer mDrawIdBuffer;
+    GLBuffer mDrawDataBuffer;
+    GLBuffer mCommandBuffer;
+
+    // persistent mappings, null on GL 4.3
+    unsigned char* mVertexData = nullptr;
+    unsigned char* mIndexData = nullptr;
+    // Map fell back to glMapBufferRange
+    bool mRangeMapped = false;
+
+    size_t mVertexCount = 0;
+    size_t mIndexCount = 0;
+    std::vector<DrawCommand> mCommands;
+    std::vector<DrawData> mDrawData;
+    unsigned int mInstanceCount = 1;
+    bool mCommandsDirty = false;
+    bool mDrawDataDirty = false;
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include "utils/VertexFormat.h"
+#include "utils/BezierSurface.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <vector>
+
+// shape of the ring screen, see GenerateControlPoints4x4
+struct RingScreenParams {
+    float radius = 2.0f;
+    float height = 1.0f;
+    float arcAngle = glm::half_pi<float>(); // radians
+};
+
+// Runtime editing of the ring screen control points.
+// Every edit re-tessellates the full grid: a single bicubic patch has non-zero
+// bernstein weights everywhere on (0, 1), SetParams moves all 16 points and arc
+// length u re-places every row, so there is no smaller region to track. Update()
+// evaluates the grid from cached basis tables and streams it into the vertex
+// buffer with one glBufferSubData, well inside kEditBudgetMs at the ring's segment
+// counts. The buffer must hold the grid in row order (no vertex fetch reordering)
+// and allow glBufferSubData.
+class RingScreenEditor
+{
+public:
+    RingScreenEditor(int segmentsU, int segmentsV, VertexLayout layout,
+        const RingScreenParams& params = RingScreenParams());
+
+    void SetParams(const RingScreenParams& params);
+    const RingScreenParams& GetParams() const noexcept { return mParams; }
+
+    void SetControlPoint(int i, int j, const glm::vec3& point);
+    const glm::vec3& GetControlPoint(int i, int j) const { return mControlPoints[i][j]; }
+    // the full 4x4 grid, e.g. for a mesh cache key
+    void GetControlPoints(glm::vec3 controlPoints[4][4]) const;
+
+    // place rows at even arc length, see ArcLengthTable
+    void SetArcLengthUV(bool enable);
+    bool IsArcLengthUV() const noexcept { return mArcLengthUV; }
+
+    bool IsDirty() const noexcept { return mDirty; }
+
+    // Re-tessellate the grid into vbo, the grid starting at baseOffset bytes.
+    // Returns the CPU time spent in ms
+    float Update(unsigned int vbo, size_t baseOffset = 0);
+
+    // edits slower than this are reported
+    static constexpr float kEditBudgetMs = 1.0f;
+
+private:
+    void updateBasisU();
+    void evaluateGrid();
+
+private:
+    int mSegmentsU;
+    int mSegmentsV;
+    VertexLayout mLayout;
+    RingScreenParams mParams;
+    glm::vec3 mControlPoints[4][4];
+
+    // bernstein weights and derivatives per grid row (u) / column (v)
+    std::vector<glm::vec4> mBasisU, mDerivU;
+    std::vector<glm::vec4> mBasisV, mDerivV;
+
+    bool mArcLengthUV = false;
+    bool mBasisUStale = false;
+    ArcLengthTable mArcLength;
+
+    // packed copy of the whole grid, uploaded from here
+    std::vector<unsigned char> mPacked;
+    bool mDirty = false;
+};
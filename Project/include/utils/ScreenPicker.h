@@ -0,0 +1,70 @@
+#pragma once
+#include "utils/BezierSurface.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+// result of a ray pick against the ring screen
+struct ScreenHit {
+    float distance = 0.0f;         // along the (normalized) ray
+    glm::vec3 position{ 0.0f };    // world space
+    glm::vec2 uv{ 0.0f };          // screen texture coordinates
+    glm::ivec2 pixel{ 0 };         // desktop pixel, i.e. texel of the streamed desktop texture
+};
+
+// Ray picking for desktop input (gaze or controller rays).
+// A BVH over a coarse tessellation of the patch finds the hit triangle, Newton
+// iteration on the bicubic patch then moves the hit onto the exact surface, so
+// the coarse grid only has to be good enough as a starting guess. Only the
+// front (visible) side of the screen is hit.
+class RingScreenPicker
+{
+public:
+    // arcLengthUV: texture u is the arc length fraction, as in the rendered mesh
+    void Build(const glm::vec3 controlPoints[4][4], bool arcLengthUV = false, int segments = 32);
+    void SetModelMatrix(const glm::mat4& model);
+    void SetDesktopSize(int width, int height);
+
+    // world space ray, returns false on a miss
+    bool Pick(const glm::vec3& origin, const glm::vec3& direction, ScreenHit& hit) const;
+
+    // world space point and texture coordinates at bezier parameters (u, v)
+    glm::vec3 SurfacePoint(const glm::vec2& params) const;
+    glm::vec2 TextureCoords(const glm::vec2& params) const;
+    glm::ivec2 DesktopPixel(const glm::vec2& uv) const;
+
+    // picks slower than this are reported by printPickReport
+    static constexpr float kPickBudgetUs = 5.0f;
+
+private:
+    struct Node {
+        glm::vec3 boxMin;
+        int offset; // leaf: first triangle, inner: right child (left child is the next node)
+        glm::vec3 boxMax;
+        int count;  // triangles in a leaf, 0 for inner nodes
+    };
+
+    int buildNode(int begin, int end);
+    bool intersectTriangle(int triangle, const glm::vec3& origin, const glm::vec3& direction,
+        float& distance, glm::vec2& params) const;
+    void refine(const glm::vec3& origin, const glm::vec3& direction, float& distance, glm::vec2& params) const;
+
+private:
+    glm::vec3 mControlPoints[4][4];
+    ArcLengthTable mArcLength;
+    bool mArcLengthUV = false;
+
+    // coarse grid in local space with the bezier (u, v) of every vertex
+    std::vector<glm::vec3> mPositions;
+    std::vector<glm::vec2> mParams;
+    std::vector<glm::ivec3> mTriangles;
+    std::vector<Node> mNodes;
+
+    glm::mat4 mLocalToWorld{ 1.0f };
+    glm::mat4 mWorldToLocal{ 1.0f };
+    int mDesktopWidth = 1024;
+    int mDesktopHeight = 768;
+};
+
+// Time rays from eye to random points of the screen and check the picked pixel
+// against the known one, prints the average time per pick and the worst error
+void printPickReport(const RingScreenPicker& picker, const glm::vec3& eye, int rayCount = 10000);
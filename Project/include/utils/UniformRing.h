@@ -0,0 +1,71 @@
+#pragma once
+#include "utils/GLObject.h"
+#include <cstddef>
+#include <vector>
+
+// Per-frame uniform data sub-allocated from one buffer split into a region per
+// frame in flight. Blocks are copied in with Push() and bound with
+// glBindBufferRange; a fence per region keeps the CPU from overwriting data the
+// GPU still reads. With GL 4.4 the buffer is persistently mapped, otherwise each
+// Push() maps its range unsynchronized (the fences still do the syncing).
+// A frame that pushes more than its region holds grows the ring: the rest of the
+// frame goes to a new buffer with regions twice the size, the old buffer keeps the
+// blocks bound before and is deleted once the GPU is done with that frame. An offset
+// from Push() therefore has to be bound before the next Push().
+class UniformRing
+{
+public:
+    UniformRing(size_t frameBytes, int framesInFlight = 3);
+    ~UniformRing();
+
+    UniformRing(const UniformRing&) = delete;
+    UniformRing& operator=(const UniformRing&) = delete;
+
+    // wait until the GPU is done with the next region and start filling it
+    void BeginFrame();
+    // fence the region after the frame's last draw
+    void EndFrame();
+
+    // copy bytes into the current region, returns the offset to bind (grows the ring when full)
+    size_t Push(const void* data, size_t bytes);
+    template <typename T>
+    size_t Push(const T& block) { return Push(&block, sizeof(T)); }
+
+    void Bind(unsigned int binding, size_t offset, size_t bytes) const;
+    // Push and Bind in one go
+    template <typename T>
+    void PushAndBind(unsigned int binding, const T& block) { Bind(binding, Push(block), sizeof(T)); }
+
+    bool IsPersistent() const noexcept { return mMapped != nullptr; }
+    size_t GetFrameBytes() const noexcept { return mFrameBytes; }
+    // frames where BeginFrame had to wait for the GPU
+    int GetStallCount() const noexcept { return mStalls; }
+
+    // delete the buffer and fences, has to run while the context is current
+    void Release();
+
+private:
+    // storage for every region, mapped persistently when the context allows it
+    void allocate();
+    // move to regions of at least frameBytes, keeping the old buffer until the GPU is done with it
+    void grow(size_t frameBytes);
+
+    // a buffer replaced by a larger one, still read by the frames up to lastFrame
+    struct RetiredBuffer {
+        GLBuffer buffer;
+        long long lastFrame;
+    };
+
+private:
+    GLBuffer mBuffer;
+    unsigned char* mMapped = nullptr;
+    size_t mFrameBytes;
+    size_t mAlignment = 256;
+    int mFramesInFlight;
+    int mFrame = -1;
+    size_t mHead = 0;
+    std::vector<void*> mFences; // GLsync per region
+    long long mFrameNumber = -1; // frames begun so far, minus one
+    std::vector<RetiredBuffer> mRetired;
+    int mStalls = 0;
+};
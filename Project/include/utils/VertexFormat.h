@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// Vertex layouts of the scene meshes (attribute 0 = pos, 1 = normal, 2 = uv)
+//  Float32     : pos 3 x float | normal 3 x float     | uv 2 x float   (32 bytes)
+//  PackedFloat : pos 3 x float | normal 2_10_10_10_REV | uv 2 x unorm16 (20 bytes)
+//  PackedHalf  : pos 4 x half  | normal 2_10_10_10_REV | uv 2 x unorm16 (16 bytes)
+// Packed attributes are normalized, so the vertex fetch decodes them and the
+// shaders keep reading plain vec3/vec2 inputs.
+enum class VertexLayout {
+    Float32,
+    PackedFloat,
+    PackedHalf
+};
+
+// bytes per vertex of the layout
+unsigned int vertexStride(VertexLayout layout);
+
+// Pack interleaved 8-float vertices (pos, normal, uv) into the layout.
+// dst must hold vertexCount * vertexStride(layout) bytes
+void packVertices(const float* src, size_t vertexCount, VertexLayout layout, unsigned char* dst);
+void packVertices(const std::vector<float>& src, VertexLayout layout, std::vector<unsigned char>& dst);
+
+// Set attributes 0/1/2 of the bound VAO to read the bound GL_ARRAY_BUFFER
+void setupVertexAttributes(VertexLayout layout);
@@ -6,9 +6,29 @@
 #include <thread>
 #include <string>
 #include <atomic>
+#include <algorithm>
 #include "utils/CustomCamera.h"
 #include "Shader.h"
 #include "utils/Helper.h"
+#include "utils/VertexFormat.h"
+#include "utils/MeshOptimizer.h"
+#include "utils/MultiResolution.h"
+#include "utils/MeshCache.h"
+#include "utils/BezierSurface.h"
+#include "utils/ScreenEditor.h"
+#include "utils/GpuTimer.h"
+#include "utils/ScreenPicker.h"
+#include "utils/ResourceManager.h"
+#include "utils/UniformRing.h"
+#include "utils/GLStateCache.h"
+#include "utils/RenderGraph.h"
+#include "utils/DynamicResolution.h"
+#include "utils/SceneBatch.h"
+#include "utils/Culling.h"
+#include "utils/AppWindow.h"
+#include "utils/DistortionMesh.h"
+#include "utils/LensLut.h"
+#include "utils/LensProfile.h"
 #include <memory>
 
 //global values
@@ -24,18 +44,84 @@ float lastY = 300.0f;
 bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
+// window framebuffer size, kept up to date by framebuffer_size_callback
+int windowWidth = 1200;
+int windowHeight = 800;
 
 bool b_applyDistortion = false;
 bool b_useLighting = false;
 bool b_dualLighting = false;
 
+// vertex layout of the ring screen and floor meshes
+VertexLayout sceneVertexLayout = VertexLayout::PackedHalf;
+// reorder the ring screen for the post-transform / pre-transform vertex caches
+bool b_optimizeVertexCache = true;
+bool b_optimizeVertexFetch = true;
+// print the ACMR/ATVR gain per segment count at startup
+bool b_reportVertexCache = false;
+// load the tessellated ring screen from the binary mesh cache. A miss (or no cache) tessellates
+// straight into the scene batch's mapped buffers, the cache is then written on a worker thread
+bool b_useMeshCache = true;
+const char* meshCacheDirectory = "mesh_cache";
+// place screen rows at even arc length so the desktop texels spread uniformly across the ring
+bool b_arcLengthUV = true;
+// print texels per degree across the screen for bezier vs arc length u at startup
+bool b_reportTexelDensity = false;
+// time and verify the desktop picking rays at startup
+bool b_reportPicking = false;
+// live screen curvature editing, keeps the ring vertices in row order in a dynamic buffer
+bool b_editableScreen = true;
+// evaluate the ring screen in the vertex shader from a (u,v) grid, animating a flat-to-curved morph
+bool b_gpuBezierScreen = false;
+// ray-cast the exact cylinder section in the fragment shader on a bounding box, no screen mesh
+bool b_rayCastScreen = false;
+// print the GPU cost of the tessellated vs ray-cast screen once from the first frame's view
+bool b_reportScreenCost = false;
+// scale the offscreen scene resolution to hold the GPU frame time under the 90 Hz budget
+bool b_dynamicResolution = true;
+// fixed foveated rendering: the middle of each eye's view at full density, the 3x3 cells
+// around it at peripheryDensity, M toggles it
+bool b_multiResolution = true;
+float foveaSize = 0.5f;
+float peripheryDensity = 0.5f;
+// MSAA of the offscreen scene, resolved by the distortion shader, clamped to what the GL supports
+int sceneSampleCount = 4;
+// the distortion shader filters bilinearly between the resolved scene texels, off reads the nearest one
+bool b_sceneBilinear = true;
+// eyes side by side / on top of each other in the window, or one mono view
+StereoLayout stereoLayout = kStereoSideBySide;
+// eye separation in meters and the distance where the eyes' images coincide
+float stereoIpd = 0.064f;
+float stereoConvergence = 2.0f;
+// how the scene pass covers the eyes: a pass per eye, or one pass where every draw
+// goes out once per eye through its instances, or once for both with GL_OVR_multiview2
+enum StereoSubmission { kStereoPerEye, kStereoInstanced, kStereoMultiview };
+// submit both eyes in one pass when the GL can route the eyes (see StereoSubmission)
+bool b_singlePassStereo = true;
+// quads per eye of the distortion warp mesh
+int warpMeshColumns = 40;
+int warpMeshRows = 40;
+// HMD lens profiles (LensProfile.h), 0 steps through them; the built-in default without the file
+const char* lensProfilePath = "lens_profiles.txt";
+// texels per side of the inverse lens lookup, per eye and channel
+int lensLutSize = 256;
+// poll events again and write the view into the uniform ring right before the scene draws
+bool b_latePose = true;
+// CPU time of the event poll behind the current camera pose
+double inputSampleTime = 0.0;
+// rotational timewarp: poll once more right before the distortion pass and re-aim its
+// sampling at the newest head rotation, the scene keeps the pose it was rendered with
+bool b_timewarp = true;
+
 // window size callback
-void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-    glViewport(0, 0, width, height);
+void framebuffer_size_callback(int width, int height) {
+    // the render graph resizes its targets and viewports from these
+    windowWidth = width;
+    windowHeight = height;
 }
 
 // mouse move callback
-void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
+void mouse_callback(double xpos, double ypos) {
     if (firstMouse) {
         lastX = xpos;
         lastY = ypos;
@@ -52,322 +138,865 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
 }
 
 // mouse scroll callback
-void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
-    camera_ptr->ProcessMouseScroll(yoffset);
+void scroll_callback(double offset) {
+    camera_ptr->ProcessMouseScroll(offset);
 }
 
 // process keyboard input
-void processInput(GLFWwindow* window) {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, true);
+void processInput(AppWindow& window) {
+    if (window.IsKeyDown(GLFW_KEY_ESCAPE))
+        window.SetShouldClose(true);
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    if (window.IsKeyDown(GLFW_KEY_W))
         camera_ptr->ProcessKeyboard(GLFW_KEY_W, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    if (window.IsKeyDown(GLFW_KEY_S))
         camera_ptr->ProcessKeyboard(GLFW_KEY_S, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    if (window.IsKeyDown(GLFW_KEY_A))
         camera_ptr->ProcessKeyboard(GLFW_KEY_A, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    if (window.IsKeyDown(GLFW_KEY_D))
         camera_ptr->ProcessKeyboard(GLFW_KEY_D, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+    if (window.IsKeyDown(GLFW_KEY_SPACE))
         camera_ptr->ProcessKeyboard(GLFW_KEY_SPACE, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (window.IsKeyDown(GLFW_KEY_LEFT_SHIFT))
         camera_ptr->ProcessKeyboard(GLFW_KEY_LEFT_SHIFT, deltaTime);
 }
 
-int main() {
-    if (!glfwInit()) {
-        std::cerr << "GLFW Init Failed!!" << std::endl;
+int main(int argc, char** argv) {
+    // a GLFW window, or the EGL offscreen context of a VR_HEADLESS build
+    AppWindowDesc windowDesc;
+    windowDesc.width = windowWidth;
+    windowDesc.height = windowHeight;
+    if (!parseAppWindowArguments(argc, argv, windowDesc))
         return -1;
-    }
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_SAMPLES, 4); // 4x MSAA
-
-    GLFWwindow* window = glfwCreateWindow(1200, 800, "VR Scene", NULL, NULL);
-    if (window == NULL) {
-        std::cerr << "CreateWindow Failed!!!" << std::endl;
-        glfwTerminate();
+    AppWindow window;
+    if (!window.Create(windowDesc))
         return -1;
-    }
-    glfwMakeContextCurrent(window);
 
     // set callbacks
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
+    window.SetFramebufferSizeCallback(framebuffer_size_callback);
+    window.GetFramebufferSize(windowWidth, windowHeight);
+    window.SetCursorPosCallback(mouse_callback);
+    window.SetScrollCallback(scroll_callback);
+    camera_ptr->SetIpd(stereoIpd);
+    camera_ptr->SetConvergence(stereoConvergence);
+
+    // multisample textures for the scene color and depth attachments
+    int maxColorSamples = 1, maxDepthSamples = 1;
+    glGetIntegerv(GL_MAX_COLOR_TEXTURE_SAMPLES, &maxColorSamples);
+    glGetIntegerv(GL_MAX_DEPTH_TEXTURE_SAMPLES, &maxDepthSamples);
+    sceneSampleCount = std::max(1, std::min(sceneSampleCount, std::min(maxColorSamples, maxDepthSamples)));
 
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cerr << "GLAD Loaded Failed!!" << std::endl;
-        return -1;
+    // enable depth test and multisample
+    GLStateCache::Enable(GL_DEPTH_TEST);
+    GLStateCache::Enable(GL_MULTISAMPLE);
+    GLStateCache::Enable(GL_CULL_FACE);
+
+    // owns every long-lived GL object below, released before the context goes away
+    ResourceManager resources;
+
+    // Single-pass stereo: multiview routes the views itself, the layer extension lets an
+    // instanced draw send each instance to its eye's layer. Without both the eyes take a pass each
+    void* framebufferTextureMultiview = window.GetProcAddress("glFramebufferTextureMultiviewOVR");
+    bool multiviewStereo = framebufferTextureMultiview && hasGLExtension("GL_OVR_multiview2");
+    bool layerStereo = hasGLExtension("GL_ARB_shader_viewport_layer_array");
+    StereoSubmission singlePassSubmission = multiviewStereo ? kStereoMultiview
+        : layerStereo ? kStereoInstanced : kStereoPerEye;
+    std::cout << "Single-pass stereo: " << (multiviewStereo ? "GL_OVR_multiview2"
+        : layerStereo ? "instanced, layer from the vertex shader" : "not supported, one pass per eye") << std::endl;
+
+    // create shader, every stage with the shared uniform blocks and the scene vertex shaders
+    // with a stereo variant in front of them (#extension lines go first)
+    auto createSceneProgram = [&resources](const char* vertexSource, const char* fragmentSource, const char* header) {
+        std::string vertex = shaderVariant(shaderVariant(vertexSource, uniformBlocksHeader).c_str(), header);
+        return resources.AdoptProgram(createShaderProgram(vertex.c_str(),
+            shaderVariant(fragmentSource, uniformBlocksHeader).c_str()));
+    };
+    const char* stereoHeader = layerStereo ? stereoLayerHeader : stereoPassHeader;
+    unsigned int sceneShader = createSceneProgram(sceneVertexShader, sceneFragmentShader, stereoHeader);
+    std::string distortionFragment = sceneSampleCount > 1 ? std::string(distortionFragmentShader)
+        : shaderVariant(distortionFragmentShader, distortionSingleSampleHeader);
+    unsigned int distortionShader = createSceneProgram(distortionVertexShader, distortionFragment.c_str(), "");
+    unsigned int bezierSceneShader = createSceneProgram(sceneBezierVertexShader, sceneFragmentShader, stereoHeader);
+    unsigned int rayCastSceneShader = createSceneProgram(sceneRayCastVertexShader, sceneRayCastFragmentShader, stereoHeader);
+    // the same scene shaders with both views in one draw
+    unsigned int multiviewSceneShader = 0, multiviewBezierSceneShader = 0, multiviewRayCastSceneShader = 0;
+    if (multiviewStereo) {
+        multiviewSceneShader = createSceneProgram(sceneVertexShader, sceneFragmentShader, stereoMultiviewHeader);
+        multiviewBezierSceneShader = createSceneProgram(sceneBezierVertexShader, sceneFragmentShader, stereoMultiviewHeader);
+        multiviewRayCastSceneShader = createSceneProgram(sceneRayCastVertexShader, sceneRayCastFragmentShader, stereoMultiviewHeader);
     }
 
-    // enable depth test and multisample
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_MULTISAMPLE);
-    glEnable(GL_CULL_FACE);
-
-    // create shader
-    unsigned int sceneShader = createShaderProgram(sceneVertexShader, sceneFragmentShader);
-    unsigned int distortionShader = createShaderProgram(distortionVertexShader, distortionFragmentShader);
-
-    // create ring  screen
-    std::vector<float> ringVertices;
-    std::vector<unsigned int> ringIndices;
-    createRingScreenWithBezier(72, 72, ringVertices, ringIndices);
+    // create ring  screen, mapped from the mesh cache when the key still matches
+    const int ringSegments = 72;
+    RingScreenEditor ringEditor(ringSegments, ringSegments, sceneVertexLayout);
+    ringEditor.SetArcLengthUV(b_arcLengthUV);
+
+    MeshCacheKey ringKey;
+    ringEditor.GetControlPoints(ringKey.controlPoints);
+    ringKey.segmentsU = ringSegments;
+    ringKey.segmentsV = ringSegments;
+    ringKey.layout = sceneVertexLayout;
+    // the editor streams whole rows, so vertices have to stay in grid order
+    ringKey.flags = (b_optimizeVertexCache ? kMeshFlagOptimizeVertexCache : 0u)
+        | (b_optimizeVertexFetch && !b_editableScreen ? kMeshFlagOptimizeVertexFetch : 0u)
+        | (b_arcLengthUV ? kMeshFlagArcLengthUV : 0u);
+    std::string ringCachePath = meshCachePath(meshCacheDirectory, "ring_screen", ringKey);
+
+    MeshCacheFile ringCache;
+    if (b_useMeshCache)
+        ringCache.Open(ringCachePath, ringKey);
+
+    // gaze / controller picking on the virtual desktop, same model matrix as the rendered screen
+    glm::mat4 screenModel = glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    RingScreenPicker ringPicker;
+    ringPicker.Build(ringKey.controlPoints, b_arcLengthUV);
+    ringPicker.SetModelMatrix(screenModel);
+    ringPicker.SetDesktopSize(1024, 768);
+    if (b_reportPicking)
+        printPickReport(ringPicker, camera_ptr->GetEye());
+
+    if (b_reportVertexCache)
+        printRingScreenCacheReport({ 16, 32, 72, 128 });
+    // seen from the start camera position, in the screen's local space
+    if (b_reportTexelDensity) {
+        glm::vec3 viewPoint = glm::vec3(glm::inverse(screenModel) * glm::vec4(camera_ptr->GetEye(), 1.0f));
+        printScreenTexelDensityReport(ringKey.controlPoints, viewPoint, 1024);
+    }
     
-    unsigned int ringVAO, ringVBO, ringEBO;
-    glGenVertexArrays(1, &ringVAO);
-    glGenBuffers(1, &ringVBO);
-    glGenBuffers(1, &ringEBO);
-
-    glBindVertexArray(ringVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, ringVBO);
-    glBufferData(GL_ARRAY_BUFFER, ringVertices.size() * sizeof(float), ringVertices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ringEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, ringIndices.size() * sizeof(unsigned int), ringIndices.data(), GL_STATIC_DRAW);
-
-    // pos attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // nor attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // tex attribute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    // All static scene geometry shares one vertex/index buffer and goes out in a single
+    // multi-draw. Indices are per draw, so the ring as the largest mesh picks their size
+    const size_t ringVertexCount = size_t(ringSegments + 1) * (ringSegments + 1);
+    const size_t ringIndexCount = size_t(ringSegments) * ringSegments * 6;
+    SceneBatch sceneBatch(sceneVertexLayout, 64 * 1024, 256 * 1024, 64,
+        ringVertexCount <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT);
+
+    DrawData screenDraw;
+    screenDraw.model = screenModel;
+    screenDraw.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(screenModel))));
+    screenDraw.color = glm::vec4(1.0f);
+    int ringDraw;
+    std::thread ringCacheWriter;
+    if (ringCache.IsOpen()) {
+        // straight from the mapped cache file into the batch
+        MeshBlobView ringMesh = ringCache.View();
+        ringDraw = sceneBatch.Add(ringMesh.vertexData, ringMesh.vertexCount, ringMesh.indexData, ringMesh.indexCount,
+            ringMesh.indexType, screenDraw);
+        // the batch owns a copy now
+        ringCache.Close();
+    }
+    else {
+        // tessellate straight into the batch's mapped range, no host copy
+        ArcLengthTable arcLength;
+        if (b_arcLengthUV)
+            arcLength.Build(ringKey.controlPoints);
+        ringDraw = sceneBatch.Reserve(ringVertexCount, ringIndexCount, screenDraw);
+        createRingScreenMapped(ringKey.controlPoints, ringSegments, ringSegments, sceneBatch, ringDraw,
+            b_arcLengthUV ? &arcLength : nullptr);
+
+        // the reordered mesh for the next launch, off the render thread
+        if (b_useMeshCache) {
+            ringCacheWriter = std::thread([ringKey, ringCachePath]() {
+                MeshBlobs ringBlobs;
+                buildRingScreenMesh(ringKey, ringBlobs);
+                writeMeshCache(ringCachePath, ringKey, ringBlobs.View());
+            });
+        }
+    }
+
+    // shared (u,v) grid for the vertex shader evaluated screen, 4 bytes per vertex
+    std::vector<unsigned short> gridUVs;
+    std::vector<unsigned int> gridIndices;
+    createRingScreenUVGrid(ringSegments, ringSegments, gridUVs, gridIndices);
+    optimizeVertexCache(gridIndices, gridUVs.size() / 2);
+
+    unsigned int gridVAO = resources.CreateVertexArray();
+    unsigned int gridVBO = resources.CreateBuffer();
+    unsigned int gridEBO = resources.CreateBuffer();
+
+    GLStateCache::BindVertexArray(gridVAO);
+    GLStateCache::BindBuffer(GL_ARRAY_BUFFER, gridVBO);
+    glBufferData(GL_ARRAY_BUFFER, gridUVs.size() * sizeof(unsigned short), gridUVs.data(), GL_STATIC_DRAW);
+
+    GLStateCache::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, gridEBO);
+    unsigned int gridIndexType = uploadIndexBuffer(gridIndices, gridUVs.size() / 2, GL_STATIC_DRAW);
+    GLsizei gridIndexCount = static_cast<GLsizei>(gridIndices.size());
+
+    // tex attribute only
+    glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, 2 * sizeof(unsigned short), (void*)0);
     glEnableVertexAttribArray(2);
 
-    glBindVertexArray(0);
+    GLStateCache::BindVertexArray(0);
+
+    // All per-frame and per-object uniform blocks (the 256 byte bezier patch included)
+    // are sub-allocated from this ring, one region per frame in flight
+    UniformRing frameUniforms(16 * 1024);
+
+    // bounding box proxy of the ray-cast screen
+    unsigned int proxyVAO, proxyVBO;
+    createProxyCube(proxyVAO, proxyVBO);
+    GLStateCache::BindVertexArray(0);
+    resources.AdoptVertexArray(proxyVAO);
+    resources.AdoptBuffer(proxyVBO);
 
     // generate dynamicTexture
-    unsigned int dynamicTexture;
-    glGenTextures(1, &dynamicTexture);
-    glBindTexture(GL_TEXTURE_2D, dynamicTexture);
+    unsigned int dynamicTexture = resources.CreateTexture();
+    GLStateCache::BindTexture(GL_TEXTURE_2D, dynamicTexture);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1024, 768, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    // create (FBO)
-    unsigned int framebuffer;
-    glGenFramebuffers(1, &framebuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    // Offscreen targets and their framebuffers are declared per frame, see the render loop
+    RenderGraph renderGraph;
+    renderGraph.SetBackbuffer(window.GetBackbuffer());
+    renderGraph.SetMultiviewFunction(framebufferTextureMultiview);
+    int renderGraphCompiles = 0;
+
+    // GPU frame time, read back a few frames late, drives the offscreen render scale
+    GpuFrameTimer frameTimer;
+    InputLatencyMeter latencyMeter;
+    float poseLatencyMs = 0.0f;
+    float latchGainMs = 0.0f;
+    // head rotation the distortion pass corrected for in the last frame, and how much
+    // newer its poll was than the pose the scene was drawn with
+    float timewarpDegrees = 0.0f;
+    float timewarpGainMs = 0.0f;
+    DynamicResolution dynamicResolution;
+
+    // Lens distortion: the inverse lens mapping solved once into a lookup texture,
+    // the warp mesh only rasterizes where the lens shows the scene
+    std::vector<LensProfile> lensProfiles;
+    if (!loadLensProfiles(lensProfilePath, lensProfiles) || lensProfiles.empty())
+        lensProfiles.assign(1, defaultLensProfile());
+    int lensProfileIndex = 0;
+    LensLut lensLut;
+    DistortionMesh distortionMesh;
+    auto buildLens = [&]() {
+        const LensProfile& profile = lensProfiles[lensProfileIndex];
+        lensLut.Build(profile, lensLutSize);
+        distortionMesh.Build(warpMeshColumns, warpMeshRows, [&profile](int eye, glm::vec2 position) {
+            for (int channel = 0; channel < 3; ++channel) {
+                glm::vec2 scene;
+                if (lensSceneCoordinates(profile, eye, channel, position, scene)
+                    && glm::all(glm::greaterThanEqual(scene, glm::vec2(0.0f))) && glm::all(glm::lessThanEqual(scene, glm::vec2(1.0f))))
+                    return true;
+            }
+            return false;
+        });
+        // the error is in [0, 1] image coordinates, in pixels of an eye's part of the window
+        const int lensEyeWidth = stereoLayout == kStereoSideBySide ? windowWidth / 2 : windowWidth;
+        std::cout << "Lens profile " << profile.name << ": k " << profile.k1 << " " << profile.k2 << " " << profile.k3
+            << ", " << lensLutSize << "x" << lensLutSize << " RG16F per eye and channel, round trip error "
+            << lensLut.GetMaxRoundTripError() * lensEyeWidth << " px in a " << lensEyeWidth << " px wide eye, "
+            << lensLut.GetUnsolvedCount() << " texels unsolved, " << distortionMesh.GetLensCellCount() << "/"
+            << distortionMesh.GetCellsPerEye() * 2 << " warp cells drawn" << std::endl;
+    };
+    buildLens();
+    bool lensKeyDown = false;
+    bool multiResKeyDown = false;
+    MultiResLayout multiResLayout;
+
+    // Rendering a simple plane as a floor, uploaded once
+    float floorVertices[] = {
+        -0.5f, -0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  0.0f, 0.0f,
+         0.5f, -0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  1.0f, 0.0f,
+         0.5f,  0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  1.0f, 1.0f,
+        -0.5f,  0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  0.0f, 1.0f
+    };
+    unsigned char floorPackedVertices[sizeof(floorVertices)];
+    packVertices(floorVertices, 4, sceneVertexLayout, floorPackedVertices);
+
+    std::vector<unsigned int> floorIndices = {
+        0, 1, 2,
+        2, 3, 0
+    };
+    // solid light grey, no texture
+    DrawData floorDraw;
+    floorDraw.model = glm::translate(glm::scale(glm::mat4(1.0f), glm::vec3(10.0f, 10.0f, 1.0f)), glm::vec3(0.0f, 0.0f, -0.5f));
+    floorDraw.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(floorDraw.model))));
+    floorDraw.color = glm::vec4(glm::vec3(200.0f / 255.0f), 0.0f);
+    int floorMesh = sceneBatch.Add(floorPackedVertices, 4, floorIndices, floorDraw);
+
+    // the floor never moves, its world box and sphere are fixed
+    AABB floorBounds;
+    BoundingSphere floorSphere;
+    computeBounds(floorVertices, 4, 8, floorBounds, floorSphere);
+    floorBounds = transformBounds(floorBounds, floorDraw.model);
+    floorSphere = transformBounds(floorSphere, floorDraw.model);
+
+    // Samplers are the only loose uniforms left, everything else comes from the uniform blocks
+    GLStateCache::UseProgram(sceneShader);
+    glUniform1i(glGetUniformLocation(sceneShader, "screenTexture"), 0);
+
+    GLStateCache::UseProgram(rayCastSceneShader);
+    glUniform1i(glGetUniformLocation(rayCastSceneShader, "screenTexture"), 0);
 
-    // create color attachments
-    unsigned int textureColorbuffer;
-    glGenTextures(1, &textureColorbuffer);
-    glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1200, 800, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColorbuffer, 0);
-
-    // Creating Render Buffer Objects (Depth and Template Attachments)
-    unsigned int rbo;
-    glGenRenderbuffers(1, &rbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, 1200, 800);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
-
-    // Checking frame buffer integrity
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "Frame buffer is un integrity!" << std::endl;
+    if (multiviewStereo) {
+        GLStateCache::UseProgram(multiviewSceneShader);
+        glUniform1i(glGetUniformLocation(multiviewSceneShader, "screenTexture"), 0);
+        GLStateCache::UseProgram(multiviewRayCastSceneShader);
+        glUniform1i(glGetUniformLocation(multiviewRayCastSceneShader, "screenTexture"), 0);
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    // Creating full-screen quads
-    unsigned int quadVAO, quadVBO;
-    createQuad(quadVAO, quadVBO);
+    GLStateCache::UseProgram(distortionShader);
+    glUniform1i(glGetUniformLocation(distortionShader, "screenTexture"), 0);
+    glUniform1i(glGetUniformLocation(distortionShader, "lensTexture"), 1);
 
-    // Set shader uniform position
-    glUseProgram(sceneShader);
-    glUniform1i(glGetUniformLocation(sceneShader, "screenTexture"), 0);
-    glUniform1i(glGetUniformLocation(sceneShader, "u_b_useLighting"), b_useLighting);
-    glUniform1i(glGetUniformLocation(sceneShader, "u_b_dualLighting"), b_dualLighting);
+    bool leftButtonDown = false;
 
-    glUseProgram(distortionShader);
-    glUniform1i(glGetUniformLocation(distortionShader, "screenTexture"), 0);
-    glUniform1i(glGetUniformLocation(distortionShader, "u_b_applyDistortion"), b_applyDistortion);
+    // culled against the camera each frame, the title shows the last frame's counts
+    Frustum viewFrustum;
+    CullStats cullStats;
+    // scene draw calls of the last frame, the same for mono and single-pass stereo
+    int sceneDrawCalls = 0;
+
+    inputSampleTime = window.GetTime();
 
     //Performance Counter
     int frameCount = 0;
     float fpsTime = 0.0f;
 
     // render loop
-    while (!glfwWindowShouldClose(window)) {
+    while (!window.ShouldClose()) {
         // Calculate frame time
-        float currentFrame = glfwGetTime();
+        float currentFrame = window.GetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
+        // State changes are counted per frame, the title shows the last full frame
+        GLStateCache::BeginFrame();
+
         frameCount++;
         fpsTime += deltaTime;
         if (fpsTime >= 1.0f) {
-            std::string title = "VR Scene - FPS: " + std::to_string(frameCount) + "; Key-WSAD_LeftShift/Space And Mouse Scroll to Control Camera; 1-VR_Distortion; 2-Use_Light; 3-Dual_Lighing; Backspace-Disable_1&2";
-            glfwSetWindowTitle(window, title.c_str());
+            GLStateStats stateStats = GLStateCache::GetFrameStats();
+            std::string title = "VR Scene - FPS: " + std::to_string(frameCount) + "; GL objects: " + std::to_string(GLObjectTracker::LiveCount()) + "; GL state changes: " + std::to_string(stateStats.submitted) + " sent/" + std::to_string(stateStats.filtered) + " filtered; Render scale: " + std::to_string(static_cast<int>(dynamicResolution.GetScale() * 100.0f + 0.5f)) + "% (GPU " + std::to_string(dynamicResolution.GetAverageMs()) + " ms); Visible objects: " + std::to_string(cullStats.visible) + "/" + std::to_string(cullStats.visible + cullStats.culled) + "; Scene draws: " + std::to_string(sceneDrawCalls) + "; Shaded pixels: " + std::to_string(static_cast<int>((b_multiResolution ? multiResLayout.GetShadedFraction() : 1.0f) * 100.0f + 0.5f)) + "% of uniform; Pose latency: " + std::to_string(poseLatencyMs) + " ms (" + std::to_string(latchGainMs) + " ms saved by late latch); Timewarp: " + std::to_string(timewarpDegrees) + " deg (" + std::to_string(timewarpGainMs) + " ms newer pose); Key-WSAD_LeftShift/Space And Mouse Scroll to Control Camera; 1-VR_Distortion; 2-Use_Light; 3-Dual_Lighing; 0-Next_Lens_Profile; Backspace-Disable_1&2; 4-Screen_Morph; 5-Ray_Cast_Screen; 6-Stereo_SideBySide; 7-Stereo_TopBottom; 8-Single_Pass_Stereo; 9-Stereo_Pass_Per_Eye; M-Multi_Resolution; Arrows/PageUp/PageDown-Screen_Shape";
+            window.SetTitle(title);
             frameCount = 0;
             fpsTime = 0.0f;
         }
 
         processInput(window);
 
+        // Render scale from the newest GPU frame time that came back
+        float gpuFrameMs = 0.0f;
+        if (frameTimer.Poll(gpuFrameMs) && b_dynamicResolution)
+            dynamicResolution.Update(gpuFrameMs);
+        latencyMeter.Poll(poseLatencyMs);
+
         // Toggle Aberration Effect
-        if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS) {
+        if (window.IsKeyDown(GLFW_KEY_1)) {
             b_applyDistortion = true;
-            glUseProgram(distortionShader);
-            glUniform1i(glGetUniformLocation(distortionShader, "u_b_applyDistortion"), b_applyDistortion);
         }
-        if (glfwGetKey(window, GLFW_KEY_BACKSPACE) == GLFW_PRESS) {
+        if (window.IsKeyDown(GLFW_KEY_BACKSPACE)) {
+            b_gpuBezierScreen = false;
+            b_rayCastScreen = false;
             b_applyDistortion = false;
-            glUseProgram(distortionShader);
-            glUniform1i(glGetUniformLocation(distortionShader, "u_b_applyDistortion"), b_applyDistortion);
-
             b_useLighting = false;
-            glUseProgram(sceneShader);
-            glUniform1i(glGetUniformLocation(sceneShader, "u_b_useLighting"), b_useLighting);
+            stereoLayout = kStereoMono;
+        }
+
+        // Next lens profile, once per press
+        bool lensKeyPressed = window.IsKeyDown(GLFW_KEY_0);
+        if (lensKeyPressed && !lensKeyDown && lensProfiles.size() > 1) {
+            lensProfileIndex = (lensProfileIndex + 1) % static_cast<int>(lensProfiles.size());
+            buildLens();
+        }
+        lensKeyDown = lensKeyPressed;
+
+        // Toggle the multi-resolution scene, once per press
+        bool multiResKeyPressed = window.IsKeyDown(GLFW_KEY_M);
+        if (multiResKeyPressed && !multiResKeyDown)
+            b_multiResolution = !b_multiResolution;
+        multiResKeyDown = multiResKeyPressed;
+
+        // Stereo output layout
+        if (window.IsKeyDown(GLFW_KEY_6)) {
+            stereoLayout = kStereoSideBySide;
+        }
+        if (window.IsKeyDown(GLFW_KEY_7)) {
+            stereoLayout = kStereoTopBottom;
+        }
+
+        // Each eye gets its part of the window, the aspect follows the layout
+        const int viewCount = stereoLayout == kStereoMono ? 1 : 2;
+        int eyeOutputWidth = stereoLayout == kStereoSideBySide ? windowWidth / 2 : windowWidth;
+        int eyeOutputHeight = stereoLayout == kStereoTopBottom ? windowHeight / 2 : windowHeight;
+        float aspect = eyeOutputHeight > 0 ? float(eyeOutputWidth) / float(eyeOutputHeight) : 1.0f;
+        auto eyeOf = [viewCount](int view) { return viewCount > 1 ? static_cast<StereoEye>(view) : kMonoEye; };
+
+        // Both eyes in one pass, or a pass per eye
+        if (window.IsKeyDown(GLFW_KEY_8)) {
+            b_singlePassStereo = true;
         }
+        if (window.IsKeyDown(GLFW_KEY_9)) {
+            b_singlePassStereo = false;
+        }
+        StereoSubmission submission = viewCount > 1 && b_singlePassStereo ? singlePassSubmission : kStereoPerEye;
+        // instanced stereo draws every instance twice, once per eye, and with multi-resolution
+        // again per cell, each through the cell's viewport
+        const int eyeInstances = submission == kStereoInstanced ? 2 : 1;
+        const int cellInstances = submission == kStereoInstanced && b_multiResolution ? 9 : 1;
+        sceneBatch.SetInstanceCount(eyeInstances * cellInstances);
 
         // Toggle lighting effects
-        if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS) {
+        if (window.IsKeyDown(GLFW_KEY_2)) {
             b_useLighting = true;
-            glUseProgram(sceneShader);
-            glUniform1i(glGetUniformLocation(sceneShader, "u_b_useLighting"), b_useLighting);
         }
-        if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS) {
+        if (window.IsKeyDown(GLFW_KEY_3)) {
             b_dualLighting = !b_dualLighting;
-            glUseProgram(sceneShader);
-            glUniform1i(glGetUniformLocation(sceneShader, "u_b_dualLighting"), b_useLighting);
         }
 
+        // Toggle vertex shader evaluated screen morph
+        if (window.IsKeyDown(GLFW_KEY_4)) {
+            b_gpuBezierScreen = true;
+        }
+
+        // Toggle fragment shader ray-cast screen
+        if (window.IsKeyDown(GLFW_KEY_5)) {
+            b_rayCastScreen = true;
+        }
+
+        // Live screen curvature: Up/Down radius, Left/Right arc angle, PageUp/PageDown height
+        if (b_editableScreen) {
+            RingScreenParams params = ringEditor.GetParams();
+            if (window.IsKeyDown(GLFW_KEY_UP))
+                params.radius += 1.0f * deltaTime;
+            if (window.IsKeyDown(GLFW_KEY_DOWN))
+                params.radius -= 1.0f * deltaTime;
+            if (window.IsKeyDown(GLFW_KEY_RIGHT))
+                params.arcAngle += glm::radians(30.0f) * deltaTime;
+            if (window.IsKeyDown(GLFW_KEY_LEFT))
+                params.arcAngle -= glm::radians(30.0f) * deltaTime;
+            if (window.IsKeyDown(GLFW_KEY_PAGE_UP))
+                params.height += 0.5f * deltaTime;
+            if (window.IsKeyDown(GLFW_KEY_PAGE_DOWN))
+                params.height -= 0.5f * deltaTime;
+
+            params.radius = glm::clamp(params.radius, 0.5f, 10.0f);
+            params.arcAngle = glm::clamp(params.arcAngle, glm::radians(10.0f), glm::radians(180.0f));
+            params.height = glm::clamp(params.height, 0.2f, 4.0f);
+            ringEditor.SetParams(params);
+
+            if (ringEditor.IsDirty()) {
+                ringEditor.Update(sceneBatch.GetVertexBuffer(), sceneBatch.GetVertexOffset(ringDraw));
+
+                glm::vec3 controlPoints[4][4];
+                ringEditor.GetControlPoints(controlPoints);
+                ringPicker.Build(controlPoints, b_arcLengthUV);
+            }
+        }
+
+        // Left click on the virtual desktop along the gaze ray (the cursor is captured)
+        bool leftButtonPressed = window.IsMouseButtonDown(GLFW_MOUSE_BUTTON_LEFT);
+        if (leftButtonPressed && !leftButtonDown) {
+            glm::vec3 rayOrigin, rayDirection;
+            camera_ptr->GetRay(0.0f, 0.0f, aspect, rayOrigin, rayDirection);
+            ScreenHit hit;
+            if (ringPicker.Pick(rayOrigin, rayDirection, hit))
+                std::cout << "Desktop click at (" << hit.pixel.x << ", " << hit.pixel.y << ")" << std::endl;
+        }
+        leftButtonDown = leftButtonPressed;
+
         //Updating dynamic textures
         updateDynamicTexture(dynamicTexture);
 
-        // Step 1: Render to frame buffer
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-        glEnable(GL_DEPTH_TEST);
-        glClearColor(0.05f, 0.05f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // Using Scene Shaders
-        glUseProgram(sceneShader);
+        // Frame graph, recompiled by the graph itself when the window size or render scale changes
+        renderGraph.BeginFrame(windowWidth, windowHeight);
+
+        // the scene renders at the dynamic scale, the distortion pass samples it up to the window size.
+        // One array layer per eye, layer 0 is the left eye
+        float renderScale = b_dynamicResolution ? dynamicResolution.GetScale() : 1.0f;
+        int eyeWidth = std::max(1, static_cast<int>(eyeOutputWidth * renderScale + 0.5f));
+        int eyeHeight = std::max(1, static_cast<int>(eyeOutputHeight * renderScale + 0.5f));
+        // multi-resolution: the cells of the split in a smaller target
+        if (b_multiResolution) {
+            multiResLayout.Build(eyeWidth, eyeHeight, foveaSize, peripheryDensity);
+            eyeWidth = multiResLayout.GetWidth();
+            eyeHeight = multiResLayout.GetHeight();
+        }
+        AttachmentDesc sceneColorDesc;
+        sceneColorDesc.format = GL_RGB8;
+        sceneColorDesc.width = eyeWidth;
+        sceneColorDesc.height = eyeHeight;
+        sceneColorDesc.samples = sceneSampleCount;
+        sceneColorDesc.layers = viewCount;
+        AttachmentDesc sceneDepthDesc;
+        sceneDepthDesc.format = GL_DEPTH24_STENCIL8;
+        sceneDepthDesc.width = eyeWidth;
+        sceneDepthDesc.height = eyeHeight;
+        sceneDepthDesc.samples = sceneSampleCount;
+        sceneDepthDesc.layers = viewCount;
+        int sceneColor = renderGraph.CreateAttachment("scene color", sceneColorDesc);
+        int sceneDepth = renderGraph.CreateAttachment("scene depth", sceneDepthDesc);
 
-        glm::mat4 projection = glm::perspective(glm::radians(camera_ptr->GetZoom()), 1200.0f / 800.0f, 0.1f, 100.0f);
-        glm::mat4 view = camera_ptr->GetViewMatrix();
         glm::mat4 model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
         model = glm::rotate(model, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
 
-        glUniformMatrix4fv(glGetUniformLocation(sceneShader, "model"), 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv(glGetUniformLocation(sceneShader, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(sceneShader, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-        glUniform3fv(glGetUniformLocation(sceneShader, "viewPos"), 1, glm::value_ptr(camera_ptr->GetEye()));
-
-        // Bind dynamic textures
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, dynamicTexture);
-
-        // Rendering the Ring Screen
-        glBindVertexArray(ringVAO);
-        glDrawElements(GL_TRIANGLES, ringIndices.size(), GL_UNSIGNED_INT, 0);
-
-        //  Adding a reference coordinate system
-        glUseProgram(sceneShader);
-        glUniform1i(glGetUniformLocation(sceneShader, "useLighting"), 0);
-
-        model = glm::mat4(1.0f);
-        model = glm::scale(model, glm::vec3(10.0f, 10.0f, 1.0f));
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, -0.5f));
-        glUniformMatrix4fv(glGetUniformLocation(sceneShader, "model"), 1, GL_FALSE, glm::value_ptr(model));
-
-        // Use solid color textures
-        unsigned int whiteTexture;
-        glGenTextures(1, &whiteTexture);
-        glBindTexture(GL_TEXTURE_2D, whiteTexture);
-        unsigned char whitePixel[] = { 200, 200, 200, 255 };
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, whitePixel);
-        glBindTexture(GL_TEXTURE_2D, whiteTexture);
-
-        // Rendering a simple plane as a floor
-        float floorVertices[] = {
-            -0.5f, -0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  0.0f, 0.0f,
-             0.5f, -0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  1.0f, 0.0f,
-             0.5f,  0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  1.0f, 1.0f,
-            -0.5f,  0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  0.0f, 1.0f
+        // Per-frame block, shared by every scene and post shader
+        frameUniforms.BeginFrame();
+        FrameBlock frameBlock;
+        frameBlock.time = currentFrame;
+        frameBlock.useLighting = b_useLighting;
+        frameBlock.dualLighting = b_dualLighting;
+        frameBlock.applyDistortion = b_applyDistortion;
+        frameBlock.stereoLayout = stereoLayout;
+        frameBlock.sceneSamples = sceneSampleCount;
+        frameBlock.sceneBilinear = b_sceneBilinear;
+        frameBlock.multiResViewEdges = b_multiResolution ? multiResLayout.GetViewEdges() : glm::vec4(0.5f);
+        frameBlock.multiResMiddle = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+        frameBlock.multiResSlopes = glm::vec4(0.0f);
+        if (b_multiResolution)
+            multiResLayout.GetTargetMapping(frameBlock.multiResMiddle, frameBlock.multiResSlopes);
+        frameUniforms.PushAndBind(frameBlockBinding, frameBlock);
+
+        ObjectBlock screenObject;
+        screenObject.model = model;
+        screenObject.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+        frameUniforms.PushAndBind(objectBlockBinding, screenObject);
+
+        // Ray-cast screen setup, the proxy box follows the edited shape
+        const RingScreenParams& screenParams = ringEditor.GetParams();
+        glm::vec3 proxyMin, proxyMax;
+        RingScreenBounds(proxyMin, proxyMax, screenParams.radius, screenParams.height, screenParams.arcAngle);
+
+        // Frustum culling. The screen's box has to hold every shape it can take this frame:
+        // a Bezier patch lies inside its control point hull, so the curved and the flat
+        // patch (the morph blends the two) plus the ray-cast proxy cover it
+        glm::vec3 screenPoints[4][4], flatScreenPoints[4][4];
+        ringEditor.GetControlPoints(screenPoints);
+        GenerateFlatControlPoints4x4(flatScreenPoints, screenParams.radius, screenParams.height, screenParams.arcAngle);
+        AABB curvedBounds, flatBounds, proxyBounds;
+        BezierPatchBounds(screenPoints, curvedBounds.min, curvedBounds.max);
+        BezierPatchBounds(flatScreenPoints, flatBounds.min, flatBounds.max);
+        proxyBounds.min = proxyMin;
+        proxyBounds.max = proxyMax;
+        AABB screenBounds = mergeBounds(mergeBounds(curvedBounds, flatBounds), proxyBounds);
+        // the sphere around the same hull points, the ring's box is loose once the arc bends
+        float screenHull[(16 + 16 + 8) * 3];
+        for (int i = 0; i < 16; ++i)
+            for (int k = 0; k < 3; ++k) {
+                screenHull[i * 3 + k] = screenPoints[i / 4][i % 4][k];
+                screenHull[(16 + i) * 3 + k] = flatScreenPoints[i / 4][i % 4][k];
+            }
+        for (int corner = 0; corner < 8; ++corner)
+            for (int k = 0; k < 3; ++k)
+                screenHull[(32 + corner) * 3 + k] = (corner >> k) & 1 ? proxyMax[k] : proxyMin[k];
+        AABB hullBox;
+        BoundingSphere screenSphere;
+        computeBounds(screenHull, 40, 3, hullBox, screenSphere);
+
+        // world bounds, tested in the scene pass against the views it draws with
+        const AABB objectBounds[] = { transformBounds(screenBounds, model), floorBounds };
+        const BoundingSphere objectSpheres[] = { transformBounds(screenSphere, model), floorSphere };
+        const int objectCount = sizeof(objectBounds) / sizeof(objectBounds[0]);
+        bool screenVisible = false;
+
+        // Pose the scene is drawn with, newer than the frame setup's when latched late
+        const double frameInputTime = inputSampleTime;
+        double sceneInputTime = inputSampleTime;
+        glm::mat3 renderRotation = camera_ptr->GetViewRotation();
+
+        // Scene into the offscreen color/depth attachments
+        RenderPassDesc scenePass;
+        scenePass.name = "scene";
+        scenePass.colorOutputs = { sceneColor };
+        scenePass.depthOutput = sceneDepth;
+        scenePass.viewCount = submission == kStereoMultiview ? viewCount : 0;
+        scenePass.execute = [&](const RenderGraph& graph) {
+            // Late latch: pick up the mouse events that arrived while the frame was set up
+            // and write the newest views just before the draws. Only the head rotation moves
+            // here, the position and projection keep the frame start values
+            if (b_latePose) {
+                window.PollEvents();
+                inputSampleTime = window.GetTime();
+            }
+            sceneInputTime = inputSampleTime;
+            renderRotation = camera_ptr->GetViewRotation();
+
+            PoseBlock pose = {};
+            for (int v = 0; v < viewCount; ++v) {
+                pose.view[v] = camera_ptr->GetEyeViewMatrix(eyeOf(v));
+                pose.projection[v] = camera_ptr->GetEyeProjectionMatrix(eyeOf(v), aspect, 0.1f, 100.0f);
+                pose.viewPos[v] = glm::vec4(camera_ptr->GetEyePosition(eyeOf(v)), 1.0f);
+            }
+            pose.instanceEyes = eyeInstances;
+            pose.instanceCells = cellInstances;
+
+            // Frustum culling with the latched views, a fast head turn does not leave
+            // objects culled that are in view by now. In stereo an object is drawn when
+            // either eye sees it. Both volumes hold the object, it is out when either is:
+            // the spheres go first, four per test, and only their survivors get the tighter box test
+            unsigned char objectVisible[objectCount] = {};
+            for (int v = 0; v < viewCount; ++v) {
+                unsigned char eyeVisible[objectCount];
+                viewFrustum.Extract(pose.projection[v] * pose.view[v]);
+                viewFrustum.CullSpheres(objectSpheres, objectCount, eyeVisible);
+                for (int i = 0; i < objectCount; ++i)
+                    objectVisible[i] |= eyeVisible[i] && viewFrustum.IsVisible(objectBounds[i]);
+            }
+            cullStats.visible = 0;
+            for (int i = 0; i < objectCount; ++i)
+                cullStats.visible += objectVisible[i];
+            cullStats.culled = objectCount - cullStats.visible;
+            screenVisible = objectVisible[0] != 0;
+            sceneBatch.SetVisible(floorMesh, objectVisible[1] != 0);
+
+            GLStateCache::Enable(GL_DEPTH_TEST);
+            glClearColor(0.05f, 0.05f, 0.1f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            // Using Scene Shaders, the multiview versions when the views come from the framebuffer
+            const bool multiview = submission == kStereoMultiview;
+            unsigned int sceneProgram = multiview ? multiviewSceneShader : sceneShader;
+            unsigned int bezierSceneProgram = multiview ? multiviewBezierSceneShader : bezierSceneShader;
+            unsigned int rayCastSceneProgram = multiview ? multiviewRayCastSceneShader : rayCastSceneShader;
+            GLStateCache::UseProgram(sceneProgram);
+
+            // Bind dynamic textures
+            GLStateCache::ActiveTexture(GL_TEXTURE0);
+            GLStateCache::BindTexture(GL_TEXTURE_2D, dynamicTexture);
+
+            if (b_gpuBezierScreen && screenVisible) {
+                // flat -> curved morph, the whole per-frame geometry update is the 256 byte patch
+                float morph = 0.5f - 0.5f * cos(currentFrame * 0.5f);
+                glm::vec4 patch[16];
+                for (int i = 0; i < 4; ++i)
+                    for (int j = 0; j < 4; ++j)
+                        patch[i * 4 + j] = glm::vec4(glm::mix(flatScreenPoints[i][j], screenPoints[i][j], morph), 1.0f);
+                size_t patchOffset = frameUniforms.Push(patch, sizeof(patch));
+                frameUniforms.Bind(bezierPatchBlockBinding, patchOffset, sizeof(patch));
+            }
+            // the ring only when no other screen path draws it
+            sceneBatch.SetVisible(ringDraw, screenVisible && !b_gpuBezierScreen && !b_rayCastScreen);
+
+            // Ray-cast screen, the proxy box follows the edited shape. From inside the box the
+            // front faces are behind the eye, rasterize the back faces instead (for both eyes
+            // when either is inside, the ray-cast finds the surface from the back faces too)
+            bool eyeInProxy = false;
+            RayCastScreenBlock rayCastBlock = {};
+            for (int v = 0; v < viewCount; ++v) {
+                glm::vec3 eyeLocal = glm::vec3(glm::inverse(model) * pose.viewPos[v]);
+                rayCastBlock.eyeLocal[v] = glm::vec4(eyeLocal, 1.0f);
+                eyeInProxy = eyeInProxy || (glm::all(glm::greaterThan(eyeLocal, proxyMin - 0.1f))
+                    && glm::all(glm::lessThan(eyeLocal, proxyMax + 0.1f)));
+            }
+            if (b_rayCastScreen || b_reportScreenCost) {
+                rayCastBlock.radius = screenParams.radius;
+                rayCastBlock.boxMin = proxyMin;
+                rayCastBlock.height = screenParams.height;
+                rayCastBlock.boxMax = proxyMax;
+                rayCastBlock.arcAngle = screenParams.arcAngle;
+                frameUniforms.PushAndBind(rayCastScreenBlockBinding, rayCastBlock);
+            }
+
+            // Single pass: every draw covers both eyes (instances or multiview views).
+            // Per eye: one pass per layer, the same draws again
+            sceneDrawCalls = 0;
+            const int passCount = submission == kStereoPerEye ? viewCount : 1;
+            for (int v = 0; v < passCount; ++v) {
+                if (passCount > 1)
+                    graph.SelectLayer(v);
+                pose.firstEye = v;
+                frameUniforms.PushAndBind(poseBlockBinding, pose);
+
+                // One-off cost of the screen renderers from this view: vertex cost grows with the
+                // tessellation, the ray-cast cost with the covered pixels
+                if (b_reportScreenCost) {
+                    b_reportScreenCost = false;
+                    const int iterations = 100;
+                    // LEQUAL lets every repeated draw shade its fragments, like a single draw would
+                    GLStateCache::DepthFunc(GL_LEQUAL);
+
+                    std::cout << "Ring screen GPU cost from the current view, ms per draw:" << std::endl;
+                    for (int segments : { 16, 72, 256 }) {
+                        // scoped, deleted at the end of each iteration; drawn with the screen's draw data
+                        const size_t testVertexCount = size_t(segments + 1) * (segments + 1);
+                        const size_t testIndexCount = size_t(segments) * segments * 6;
+                        SceneBatch testBatch(sceneVertexLayout, testVertexCount, testIndexCount, 1,
+                            testVertexCount <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT);
+                        int testDraw = testBatch.Reserve(testVertexCount, testIndexCount, screenDraw);
+                        createRingScreenMapped(ringKey.controlPoints, segments, segments, testBatch, testDraw);
+
+                        float ms = measureGpuTime([&]() { testBatch.Draw(drawDataBinding); }, iterations);
+                        std::cout << "  mesh " << segments << "x" << segments << " (" << testIndexCount / 3 << " triangles): " << ms << std::endl;
+                    }
+
+                    GLStateCache::UseProgram(rayCastSceneProgram);
+                    GLStateCache::BindVertexArray(proxyVAO);
+                    if (eyeInProxy)
+                        GLStateCache::CullFace(GL_FRONT);
+                    float ms = measureGpuTime([&]() { glDrawArrays(GL_TRIANGLES, 0, 36); }, iterations);
+                    GLStateCache::CullFace(GL_BACK);
+                    std::cout << "  ray-cast proxy (12 triangles): " << ms << std::endl;
+
+                    GLStateCache::DepthFunc(GL_LESS);
+                    GLStateCache::UseProgram(sceneProgram);
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                }
+
+                // Multi-resolution: every cell through its own viewport into its part of the
+                // target. Instanced stereo sends the instances to the cells' viewports, the draws
+                // stay the same. Otherwise the draws go out once per cell, culled against the
+                // cell's part of the view
+                const int cellCount = b_multiResolution && cellInstances == 1 ? 9 : 1;
+                if (b_multiResolution) {
+                    GLStateCache::Enable(GL_SCISSOR_TEST);
+                    for (int cell = 0; cell < cellInstances; ++cell) {
+                        glm::vec4 viewport;
+                        glm::ivec4 scissor;
+                        multiResLayout.GetCell(cell % 3, cell / 3, viewport, scissor);
+                        glViewportIndexedf(cell, viewport.x, viewport.y, viewport.z, viewport.w);
+                        glScissorIndexed(cell, scissor.x, scissor.y, scissor.z, scissor.w);
+                    }
+                }
+                for (int cell = 0; cell < cellCount; ++cell) {
+                    bool cellScreenVisible = screenVisible;
+                    if (cellCount > 1) {
+                        glm::vec4 viewport;
+                        glm::ivec4 scissor;
+                        multiResLayout.GetCell(cell % 3, cell / 3, viewport, scissor);
+                        if (scissor.z <= 0 || scissor.w <= 0)
+                            continue;
+                        glViewportIndexedf(0, viewport.x, viewport.y, viewport.z, viewport.w);
+                        glScissor(scissor.x, scissor.y, scissor.z, scissor.w);
+
+                        // the views this pass draws (both with multiview), narrowed to the cell
+                        const glm::mat4 crop = multiResLayout.GetCellCrop(cell % 3, cell / 3);
+                        unsigned char cellVisible[objectCount] = {};
+                        for (int e = v; e < (multiview ? viewCount : v + 1); ++e) {
+                            unsigned char eyeVisible[objectCount];
+                            viewFrustum.Extract(crop * pose.projection[e] * pose.view[e]);
+                            viewFrustum.CullSpheres(objectSpheres, objectCount, eyeVisible);
+                            for (int i = 0; i < objectCount; ++i)
+                                cellVisible[i] |= objectVisible[i] && eyeVisible[i] && viewFrustum.IsVisible(objectBounds[i]);
+                        }
+                        cellScreenVisible = cellVisible[0] != 0;
+                        sceneBatch.SetVisible(floorMesh, cellVisible[1] != 0);
+                        sceneBatch.SetVisible(ringDraw, cellScreenVisible && !b_gpuBezierScreen && !b_rayCastScreen);
+                    }
+
+                    // Rendering the Ring Screen
+                    if (!cellScreenVisible) {
+                        // turned away, no screen path draws
+                    }
+                    else if (b_gpuBezierScreen) {
+                        GLStateCache::UseProgram(bezierSceneProgram);
+
+                        GLStateCache::BindVertexArray(gridVAO);
+                        glDrawElementsInstanced(GL_TRIANGLES, gridIndexCount, gridIndexType, 0, eyeInstances * cellInstances);
+                        ++sceneDrawCalls;
+                    }
+                    else if (b_rayCastScreen) {
+                        GLStateCache::UseProgram(rayCastSceneProgram);
+                        GLStateCache::BindVertexArray(proxyVAO);
+                        if (eyeInProxy)
+                            GLStateCache::CullFace(GL_FRONT);
+                        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, eyeInstances * cellInstances);
+                        GLStateCache::CullFace(GL_BACK);
+                        ++sceneDrawCalls;
+                    }
+
+                    // The tessellated ring screen and the floor (and whatever static geometry
+                    // comes next) in one multi-draw, left out where a cell sees none of it
+                    if (cellCount > 1 && !sceneBatch.IsVisible(floorMesh) && !sceneBatch.IsVisible(ringDraw))
+                        continue;
+                    GLStateCache::UseProgram(sceneProgram);
+                    sceneBatch.Draw(drawDataBinding);
+                    ++sceneDrawCalls;
+                }
+                if (b_multiResolution) {
+                    GLStateCache::Disable(GL_SCISSOR_TEST);
+                    glViewport(0, 0, eyeWidth, eyeHeight);
+                }
+            }
         };
-        unsigned int floorIndices[] = {
-            0, 1, 2,
-            2, 3, 0
+        renderGraph.AddPass(scenePass);
+
+        // Distortion of the scene into the default frame buffer, resolving the multisample
+        // scene color on the way: no separate resolve pass writes and reads it back
+        RenderPassDesc distortionPass;
+        distortionPass.name = "distortion";
+        distortionPass.inputs = { sceneColor };
+        distortionPass.colorOutputs = { RenderGraph::kBackbuffer };
+        distortionPass.execute = [&](const RenderGraph& graph) {
+            GLStateCache::Disable(GL_DEPTH_TEST);
+            // black like the lens border the warp mesh leaves out
+            float clear = b_applyDistortion ? 0.0f : 0.1f;
+            glClearColor(clear, clear, clear, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+
+            // Timewarp: the head has turned on while the scene rendered, sample the scene
+            // where the newest rotation looks. Rotation only, the eye positions stay
+            TimewarpBlock timewarp = {};
+            glm::mat3 latestRotation = renderRotation;
+            if (b_timewarp) {
+                window.PollEvents();
+                inputSampleTime = window.GetTime();
+                latestRotation = camera_ptr->GetViewRotation();
+            }
+            for (int v = 0; v < viewCount; ++v)
+                timewarp.timewarp[v] = timewarpMatrix(renderRotation, latestRotation,
+                    camera_ptr->GetEyeProjectionMatrix(eyeOf(v), aspect, 0.1f, 100.0f));
+            frameUniforms.PushAndBind(timewarpBlockBinding, timewarp);
+            float cosine = (glm::dot(renderRotation[0], latestRotation[0]) + glm::dot(renderRotation[1], latestRotation[1])
+                + glm::dot(renderRotation[2], latestRotation[2]) - 1.0f) * 0.5f;
+            timewarpDegrees = glm::degrees(std::acos(glm::clamp(cosine, -1.0f, 1.0f)));
+
+            // Using Aberration Shaders
+            GLStateCache::UseProgram(distortionShader);
+
+            // Bind the scene color and the lens lookup
+            GLStateCache::ActiveTexture(GL_TEXTURE0);
+            GLStateCache::BindTexture(graph.GetTextureTarget(sceneColor), graph.GetTexture(sceneColor));
+            GLStateCache::ActiveTexture(GL_TEXTURE1);
+            GLStateCache::BindTexture(GL_TEXTURE_2D_ARRAY, lensLut.GetTexture());
+
+            // The warp mesh of every eye in the window, the full grids without the lens
+            distortionMesh.Draw(viewCount, b_applyDistortion);
         };
-
-        unsigned int floorVAO, floorVBO, floorEBO;
-        glGenVertexArrays(1, &floorVAO);
-        glGenBuffers(1, &floorVBO);
-        glGenBuffers(1, &floorEBO);
-
-        glBindVertexArray(floorVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, floorVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(floorVertices), floorVertices, GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, floorEBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(floorIndices), floorIndices, GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-        // Restore light settings
-        glUniform1i(glGetUniformLocation(sceneShader, "u_b_useLighting"), b_useLighting);
-        glBindTexture(GL_TEXTURE_2D, dynamicTexture);
-
-        // Step 2: Render to default frame buffer
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glDisable(GL_DEPTH_TEST);
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        // Using Aberration Shaders
-        glUseProgram(distortionShader);
-        glUniform1f(glGetUniformLocation(distortionShader, "time"), currentFrame);
-
-        // Bind frame buffer texture
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
-
-        // Render full-screen quads
-        glBindVertexArray(quadVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        renderGraph.AddPass(distortionPass);
+
+        frameTimer.Begin();
+        renderGraph.Execute();
+        frameTimer.End();
+        latchGainMs = float((sceneInputTime - frameInputTime) * 1000.0);
+        timewarpGainMs = float((inputSampleTime - sceneInputTime) * 1000.0);
+        if (renderGraph.GetCompileCount() != renderGraphCompiles) {
+            renderGraphCompiles = renderGraph.GetCompileCount();
+            renderGraph.PrintSummary();
+        }
 
         camera_ptr->PrintParams();
 
-        // Swap buffer and polling events
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        // Fence this frame's uniform region before handing the frame over
+        frameUniforms.EndFrame();
+
+        // Swap buffer and polling events, the latency runs from the pose's poll to the swap
+        window.SwapBuffers();
+        latencyMeter.Mark(inputSampleTime, window.GetTime());
+        window.PollEvents();
+        inputSampleTime = window.GetTime();
     }
 
-    // Clearing resources
-    glDeleteVertexArrays(1, &ringVAO);
-    glDeleteBuffers(1, &ringVBO);
-    glDeleteBuffers(1, &ringEBO);
-    glDeleteVertexArrays(1, &quadVAO);
-    glDeleteBuffers(1, &quadVBO);
-    glDeleteTextures(1, &dynamicTexture);
-    glDeleteFramebuffers(1, &framebuffer);
-    glDeleteRenderbuffers(1, &rbo);
-    glDeleteTextures(1, &textureColorbuffer);
-    glDeleteProgram(sceneShader);
-    glDeleteProgram(distortionShader);
-
-    glfwTerminate();
+    if (ringCacheWriter.joinable())
+        ringCacheWriter.join();
+
+    // Clearing resources, everything created through the manager should be gone now
+    frameUniforms.Release();
+    frameTimer.Release();
+    latencyMeter.Release();
+    sceneBatch.Release();
+    distortionMesh.Release();
+    lensLut.Release();
+    renderGraph.Release();
+    resources.Release();
+
+    // the headless back buffer belongs to the window, count after it is gone
+    window.Destroy();
+    GLObjectTracker::ReportLeaks();
     return 0;
 }
\ No newline at end of file
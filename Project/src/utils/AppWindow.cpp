@@ -0,0 +1,200 @@
+#include "utils/AppWindow.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+bool parseAppWindowArguments(int argc, char** argv, AppWindowDesc& desc)
+{
+    for (int i = 1; i < argc; ++i) {
+        const char* argument = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        if (ok && std::strcmp(argument, "--size") == 0)
+            ok = std::sscanf(value, "%dx%d", &desc.width, &desc.height) == 2 && desc.width > 0 && desc.height > 0;
+        else if (ok && std::strcmp(argument, "--frames") == 0)
+            ok = std::sscanf(value, "%d", &desc.frameCount) == 1 && desc.frameCount >= 0;
+        else if (ok && std::strcmp(argument, "--script") == 0)
+            desc.inputScript = value;
+        else if (ok && std::strcmp(argument, "--output") == 0)
+            desc.outputPath = value;
+        else if (ok && std::strcmp(argument, "--fixed-step") == 0)
+            ok = std::sscanf(value, "%lf", &desc.fixedTimeStep) == 1 && desc.fixedTimeStep >= 0.0;
+        else
+            ok = false;
+
+        if (!ok) {
+            std::cerr << "Bad argument " << argument << (value ? " " : "") << (value ? value : "")
+                << ", expected --size WxH, --frames N, --script file, --output file.ppm, --fixed-step seconds" << std::endl;
+            return false;
+        }
+        ++i;
+    }
+    return true;
+}
+
+#ifndef VR_HEADLESS
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+struct AppWindow::Backend {
+    GLFWwindow* window = nullptr;
+    int frameCount = 0;
+    int frame = 0;
+    FramebufferSizeCallback framebufferSizeCallback = nullptr;
+    CursorPosCallback cursorPosCallback = nullptr;
+    ScrollCallback scrollCallback = nullptr;
+
+    // GLFW callbacks, forwarded to the app's through the window user pointer
+    static Backend* of(GLFWwindow* window)
+    {
+        return static_cast<Backend*>(glfwGetWindowUserPointer(window));
+    }
+
+    static void onFramebufferSize(GLFWwindow* window, int width, int height)
+    {
+        if (Backend* backend = of(window))
+            if (backend->framebufferSizeCallback)
+                backend->framebufferSizeCallback(width, height);
+    }
+
+    static void onCursorPos(GLFWwindow* window, double x, double y)
+    {
+        if (Backend* backend = of(window))
+            if (backend->cursorPosCallback)
+                backend->cursorPosCallback(x, y);
+    }
+
+    static void onScroll(GLFWwindow* window, double xoffset, double yoffset)
+    {
+        if (Backend* backend = of(window))
+            if (backend->scrollCallback)
+                backend->scrollCallback(yoffset);
+    }
+};
+
+AppWindow::AppWindow() : mBackend(new Backend()) {}
+
+AppWindow::~AppWindow()
+{
+    Destroy();
+}
+
+bool AppWindow::Create(const AppWindowDesc& desc)
+{
+    if (!glfwInit()) {
+        std::cerr << "GLFW Init Failed!!" << std::endl;
+        return false;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // the back buffer only takes the distortion quad, the scene attachments carry the MSAA
+    glfwWindowHint(GLFW_SAMPLES, 0);
+
+    mBackend->window = glfwCreateWindow(desc.width, desc.height, desc.title.c_str(), NULL, NULL);
+    if (mBackend->window == NULL) {
+        std::cerr << "CreateWindow Failed!!!" << std::endl;
+        glfwTerminate();
+        return false;
+    }
+    glfwMakeContextCurrent(mBackend->window);
+    mBackend->frameCount = desc.frameCount;
+
+    glfwSetWindowUserPointer(mBackend->window, mBackend.get());
+    glfwSetFramebufferSizeCallback(mBackend->window, Backend::onFramebufferSize);
+    glfwSetCursorPosCallback(mBackend->window, Backend::onCursorPos);
+    glfwSetScrollCallback(mBackend->window, Backend::onScroll);
+    glfwSetInputMode(mBackend->window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cerr << "GLAD Loaded Failed!!" << std::endl;
+        Destroy();
+        return false;
+    }
+    return true;
+}
+
+void AppWindow::Destroy()
+{
+    if (!mBackend->window)
+        return;
+    glfwDestroyWindow(mBackend->window);
+    mBackend->window = nullptr;
+    glfwTerminate();
+}
+
+bool AppWindow::ShouldClose() const
+{
+    return glfwWindowShouldClose(mBackend->window)
+        || (mBackend->frameCount > 0 && mBackend->frame >= mBackend->frameCount);
+}
+
+void AppWindow::SetShouldClose(bool close)
+{
+    glfwSetWindowShouldClose(mBackend->window, close);
+}
+
+void AppWindow::SetTitle(const std::string& title)
+{
+    glfwSetWindowTitle(mBackend->window, title.c_str());
+}
+
+void AppWindow::SwapBuffers()
+{
+    glfwSwapBuffers(mBackend->window);
+    ++mBackend->frame;
+}
+
+void AppWindow::PollEvents()
+{
+    glfwPollEvents();
+}
+
+bool AppWindow::IsKeyDown(int key) const
+{
+    return glfwGetKey(mBackend->window, key) == GLFW_PRESS;
+}
+
+bool AppWindow::IsMouseButtonDown(int button) const
+{
+    return glfwGetMouseButton(mBackend->window, button) == GLFW_PRESS;
+}
+
+double AppWindow::GetTime() const
+{
+    return glfwGetTime();
+}
+
+void AppWindow::GetFramebufferSize(int& width, int& height) const
+{
+    glfwGetFramebufferSize(mBackend->window, &width, &height);
+}
+
+unsigned int AppWindow::GetBackbuffer() const
+{
+    return 0;
+}
+
+void* AppWindow::GetProcAddress(const char* name) const
+{
+    return reinterpret_cast<void*>(glfwGetProcAddress(name));
+}
+
+void AppWindow::SetFramebufferSizeCallback(FramebufferSizeCallback callback)
+{
+    mBackend->framebufferSizeCallback = callback;
+}
+
+void AppWindow::SetCursorPosCallback(CursorPosCallback callback)
+{
+    mBackend->cursorPosCallback = callback;
+}
+
+void AppWindow::SetScrollCallback(ScrollCallback callback)
+{
+    mBackend->scrollCallback = callback;
+}
+
+#endif
@@ -0,0 +1,202 @@
+#include "utils/BezierSurface.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+
+void GenerateControlPoints4x4(glm::vec3 controlPoints[4][4], float R, float H, float angle)
+{
+    for (int i = 0; i < 4; ++i) {
+        float u = float(i) / 3;
+        float theta = -angle / 2 + u * angle; // -angle/2 到 +angle/2
+        float x = R * sin(theta);
+        for (int j = 0; j < 4; ++j) {
+            float v = float(j) / 3;
+            float y = -H / 2 + v * H;
+            float z = R * (1 - cos(theta));
+            controlPoints[i][j] = glm::vec3(x, y, z);
+        }
+    }
+}
+
+void GenerateFlatControlPoints4x4(glm::vec3 controlPoints[4][4], float R, float H, float angle)
+{
+    float width = R * angle; // arc length of the curved screen
+    for (int i = 0; i < 4; ++i) {
+        float u = float(i) / 3;
+        float x = -width / 2 + u * width;
+        for (int j = 0; j < 4; ++j) {
+            float v = float(j) / 3;
+            float y = -H / 2 + v * H;
+            controlPoints[i][j] = glm::vec3(x, y, 0.0f);
+        }
+    }
+}
+
+void RingScreenBounds(glm::vec3& boxMin, glm::vec3& boxMax, float R, float H, float angle)
+{
+    float halfAngle = angle / 2;
+    float halfWidth = R * sin(std::min(halfAngle, glm::half_pi<float>()));
+    float depth = R * (1 - cos(halfAngle));
+    // a flat section has no depth, keep the box from collapsing
+    float pad = 1e-3f * R;
+    boxMin = glm::vec3(-halfWidth - pad, -H / 2 - pad, -pad);
+    boxMax = glm::vec3(halfWidth + pad, H / 2 + pad, depth + pad);
+}
+
+void BezierPatchBounds(const glm::vec3 cp[4][4], glm::vec3& boxMin, glm::vec3& boxMax)
+{
+    boxMin = boxMax = cp[0][0];
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            boxMin = glm::min(boxMin, cp[i][j]);
+            boxMax = glm::max(boxMax, cp[i][j]);
+        }
+    }
+}
+
+float bernstein(int i, float t) {
+    switch(i) {
+        case 0: return (1-t)*(1-t)*(1-t);
+        case 1: return 3*t*(1-t)*(1-t);
+        case 2: return 3*t*t*(1-t);
+        case 3: return t*t*t;
+    }
+    return 0;
+}
+
+glm::vec3 bezierSurfacePoint(const glm::vec3 cp[4][4], float u, float v) {
+    glm::vec3 p(0.0f);
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            p += bernstein(i, u) * bernstein(j, v) * cp[i][j];
+    return p;
+}
+
+float bernsteinDeriv(int i, float t) {
+    switch(i) {
+        case 0: return -3*(1-t)*(1-t);
+        case 1: return 3*(1-t)*(1-t) - 6*t*(1-t);
+        case 2: return 6*t*(1-t) - 3*t*t;
+        case 3: return 3*t*t;
+    }
+    return 0;
+}
+
+glm::vec3 bezierSurfaceTangentU(const glm::vec3 cp[4][4], float u, float v) {
+    glm::vec3 p(0.0f);
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            p += bernsteinDeriv(i, u) * bernstein(j, v) * cp[i][j];
+    return p;
+}
+
+glm::vec3 bezierSurfaceTangentV(const glm::vec3 cp[4][4], float u, float v) {
+    glm::vec3 p(0.0f);
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            p += bernstein(i, u) * bernsteinDeriv(j, v) * cp[i][j];
+    return p;
+}
+
+void ArcLengthTable::Build(const glm::vec3 controlPoints[4][4], int samples)
+{
+    mForward.resize(samples + 1);
+    mInverse.resize(samples + 1);
+
+    // chord lengths of the densely sampled curve
+    mForward[0] = 0.0f;
+    glm::vec3 prev = bezierSurfacePoint(controlPoints, 0.0f, 0.5f);
+    for (int k = 1; k <= samples; ++k) {
+        glm::vec3 p = bezierSurfacePoint(controlPoints, float(k) / samples, 0.5f);
+        mForward[k] = mForward[k - 1] + glm::length(p - prev);
+        prev = p;
+    }
+    mLength = mForward[samples];
+    for (float& s : mForward)
+        s = mLength > 0.0f ? s / mLength : 0.0f;
+    mForward[samples] = 1.0f;
+
+    // invert by walking both monotonic tables once
+    int k = 0;
+    for (int m = 0; m <= samples; ++m) {
+        float target = float(m) / samples;
+        while (k < samples - 1 && mForward[k + 1] < target)
+            ++k;
+        float span = mForward[k + 1] - mForward[k];
+        float t = span > 0.0f ? glm::clamp((target - mForward[k]) / span, 0.0f, 1.0f) : 0.0f;
+        mInverse[m] = (k + t) / samples;
+    }
+}
+
+float ArcLengthTable::lookup(const std::vector<float>& table, float x)
+{
+    float f = glm::clamp(x, 0.0f, 1.0f) * (table.size() - 1);
+    size_t i = std::min(size_t(f), table.size() - 2);
+    return glm::mix(table[i], table[i + 1], f - float(i));
+}
+
+float ArcLengthTable::Parameter(float s) const
+{
+    return IsBuilt() ? lookup(mInverse, s) : s;
+}
+
+float ArcLengthTable::ArcFraction(float u) const
+{
+    return IsBuilt() ? lookup(mForward, u) : u;
+}
+
+void printScreenTexelDensityReport(const glm::vec3 controlPoints[4][4], const glm::vec3& viewPoint, int textureWidth)
+{
+    const int samples = 512;
+    ArcLengthTable arcLength;
+    arcLength.Build(controlPoints, samples);
+
+    // horizontal view angle of the v = 0.5 curve point at u, in degrees
+    auto viewAngle = [&](float u) {
+        glm::vec3 d = bezierSurfacePoint(controlPoints, u, 0.5f) - viewPoint;
+        return glm::degrees(atan2(d.x, -d.z));
+    };
+
+    // [0] bezier u, [1] arc length u; per degree of view and per unit of screen length
+    float minDegree[2] = { 1e30f, 1e30f }, maxDegree[2] = { 0.0f, 0.0f };
+    float minLength[2] = { 1e30f, 1e30f }, maxLength[2] = { 0.0f, 0.0f };
+    float prevAngle = viewAngle(0.0f);
+    glm::vec3 prevPoint = bezierSurfacePoint(controlPoints, 0.0f, 0.5f);
+    for (int k = 1; k <= samples; ++k) {
+        float u0 = float(k - 1) / samples, u1 = float(k) / samples;
+        float angle = viewAngle(u1);
+        glm::vec3 point = bezierSurfacePoint(controlPoints, u1, 0.5f);
+        float degrees = std::abs(angle - prevAngle);
+        float length = glm::length(point - prevPoint);
+        prevAngle = angle;
+        prevPoint = point;
+        if (degrees <= 0.0f || length <= 0.0f)
+            continue;
+
+        float texels[2] = { textureWidth * (u1 - u0),
+            textureWidth * (arcLength.ArcFraction(u1) - arcLength.ArcFraction(u0)) };
+        for (int m = 0; m < 2; ++m) {
+            minDegree[m] = std::min(minDegree[m], texels[m] / degrees);
+            maxDegree[m] = std::max(maxDegree[m], texels[m] / degrees);
+            minLength[m] = std::min(minLength[m], texels[m] / length);
+            maxLength[m] = std::max(maxLength[m], texels[m] / length);
+        }
+    }
+
+    // legibility is bound by the sparsest part of the screen
+    int degreeWidth = int(std::ceil(textureWidth * minDegree[0] / minDegree[1]));
+    int lengthWidth = int(std::ceil(textureWidth * minLength[0] / minLength[1]));
+
+    std::streamsize oldPrecision = std::cout.precision();
+    std::cout << std::fixed << std::setprecision(2)
+        << "Screen texel density, " << textureWidth << " texel wide stream (bezier u | arc length u):" << std::endl
+        << "  texels per degree from (" << viewPoint.x << ", " << viewPoint.y << ", " << viewPoint.z << "): min "
+        << minDegree[0] << " | " << minDegree[1] << ", max/min " << maxDegree[0] / minDegree[0] << " | " << maxDegree[1] / minDegree[1] << std::endl
+        << "  texels per unit length: min "
+        << minLength[0] << " | " << minLength[1] << ", max/min " << maxLength[0] / minLength[0] << " | " << maxLength[1] / minLength[1] << std::endl
+        << "  arc length stream width for the same minimum density: " << degreeWidth << " per degree, "
+        << lengthWidth << " per unit length" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout.precision(oldPrecision);
+}
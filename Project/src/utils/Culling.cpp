@@ -0,0 +1,182 @@
+#include "utils/Culling.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define CULLING_SSE 1
+#include <xmmintrin.h>
+#endif
+
+void computeBounds(const float* vertices, size_t vertexCount, size_t strideFloats, AABB& box, BoundingSphere& sphere)
+{
+    box = AABB();
+    sphere = BoundingSphere();
+    if (vertexCount == 0)
+        return;
+
+    box.min = box.max = glm::vec3(vertices[0], vertices[1], vertices[2]);
+    for (size_t i = 1; i < vertexCount; ++i) {
+        const float* v = vertices + i * strideFloats;
+        glm::vec3 p(v[0], v[1], v[2]);
+        box.min = glm::min(box.min, p);
+        box.max = glm::max(box.max, p);
+    }
+
+    sphere.center = 0.5f * (box.min + box.max);
+    float radius2 = 0.0f;
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const float* v = vertices + i * strideFloats;
+        glm::vec3 d = glm::vec3(v[0], v[1], v[2]) - sphere.center;
+        radius2 = std::max(radius2, glm::dot(d, d));
+    }
+    sphere.radius = std::sqrt(radius2);
+}
+
+AABB mergeBounds(const AABB& a, const AABB& b)
+{
+    AABB box;
+    box.min = glm::min(a.min, b.min);
+    box.max = glm::max(a.max, b.max);
+    return box;
+}
+
+AABB transformBounds(const AABB& box, const glm::mat4& model)
+{
+    glm::vec3 center = 0.5f * (box.min + box.max);
+    glm::vec3 extent = 0.5f * (box.max - box.min);
+
+    glm::vec3 worldCenter = glm::vec3(model * glm::vec4(center, 1.0f));
+    glm::vec3 worldExtent(0.0f);
+    for (int column = 0; column < 3; ++column)
+        worldExtent += glm::abs(glm::vec3(model[column])) * extent[column];
+
+    AABB world;
+    world.min = worldCenter - worldExtent;
+    world.max = worldCenter + worldExtent;
+    return world;
+}
+
+BoundingSphere transformBounds(const BoundingSphere& sphere, const glm::mat4& model)
+{
+    float scale = std::max(glm::length(glm::vec3(model[0])),
+        std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    BoundingSphere world;
+    world.center = glm::vec3(model * glm::vec4(sphere.center, 1.0f));
+    world.radius = sphere.radius * scale;
+    return world;
+}
+
+void Frustum::Extract(const glm::mat4& viewProjection)
+{
+    // Gribb-Hartmann: rows of the matrix, left/right, bottom/top, near/far
+    glm::mat4 m = glm::transpose(viewProjection);
+    glm::vec4 planes[6] = {
+        m[3] + m[0], m[3] - m[0],
+        m[3] + m[1], m[3] - m[1],
+        m[3] + m[2], m[3] - m[2]
+    };
+
+    for (int i = 0; i < 8; ++i) {
+        glm::vec4 plane = planes[i < 6 ? i : 0];
+        plane /= glm::length(glm::vec3(plane));
+        mPlaneX[i] = plane.x;
+        mPlaneY[i] = plane.y;
+        mPlaneZ[i] = plane.z;
+        mPlaneW[i] = plane.w;
+    }
+}
+
+bool Frustum::IsVisible(const AABB& box) const
+{
+    glm::vec3 center = 0.5f * (box.min + box.max);
+    glm::vec3 extent = 0.5f * (box.max - box.min);
+
+#ifdef CULLING_SSE
+    const __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+    const __m128 ex = _mm_set1_ps(extent.x), ey = _mm_set1_ps(extent.y), ez = _mm_set1_ps(extent.z);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    // four planes at a time: outside when the center is farther behind a plane than the box reaches
+    for (int group = 0; group < 8; group += 4) {
+        __m128 nx = _mm_load_ps(mPlaneX + group);
+        __m128 ny = _mm_load_ps(mPlaneY + group);
+        __m128 nz = _mm_load_ps(mPlaneZ + group);
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)),
+            _mm_add_ps(_mm_mul_ps(nz, cz), _mm_load_ps(mPlaneW + group)));
+        __m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, nx), ex),
+            _mm_mul_ps(_mm_andnot_ps(signMask, ny), ey)), _mm_mul_ps(_mm_andnot_ps(signMask, nz), ez));
+        if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, reach), _mm_setzero_ps())))
+            return false;
+    }
+    return true;
+#else
+    for (int i = 0; i < 6; ++i) {
+        float distance = mPlaneX[i] * center.x + mPlaneY[i] * center.y + mPlaneZ[i] * center.z + mPlaneW[i];
+        float reach = std::abs(mPlaneX[i]) * extent.x + std::abs(mPlaneY[i]) * extent.y + std::abs(mPlaneZ[i]) * extent.z;
+        if (distance + reach < 0.0f)
+            return false;
+    }
+    return true;
+#endif
+}
+
+bool Frustum::IsVisible(const BoundingSphere& sphere) const
+{
+    unsigned char visible = 0;
+    CullSpheres(&sphere, 1, &visible);
+    return visible != 0;
+}
+
+int Frustum::CullBoxes(const AABB* boxes, size_t count, unsigned char* visible) const
+{
+    int visibleCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        visible[i] = IsVisible(boxes[i]) ? 1 : 0;
+        visibleCount += visible[i];
+    }
+    return visibleCount;
+}
+
+int Frustum::CullSpheres(const BoundingSphere* spheres, size_t count, unsigned char* visible) const
+{
+    int visibleCount = 0;
+#ifdef CULLING_SSE
+    // four spheres at a time against one plane after the other
+    for (size_t first = 0; first < count; first += 4) {
+        float x[4], y[4], z[4], r[4];
+        size_t lanes = std::min<size_t>(4, count - first);
+        for (size_t lane = 0; lane < 4; ++lane) {
+            const BoundingSphere& s = spheres[first + std::min(lane, lanes - 1)];
+            x[lane] = s.center.x;
+            y[lane] = s.center.y;
+            z[lane] = s.center.z;
+            r[lane] = s.radius;
+        }
+        const __m128 sx = _mm_loadu_ps(x), sy = _mm_loadu_ps(y), sz = _mm_loadu_ps(z);
+        const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(r));
+
+        __m128 inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+        for (int i = 0; i < 6; ++i) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(mPlaneX[i]), sx),
+                _mm_mul_ps(_mm_set1_ps(mPlaneY[i]), sy)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(mPlaneZ[i]), sz), _mm_set1_ps(mPlaneW[i])));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            visible[first + lane] = (mask >> lane) & 1;
+            visibleCount += visible[first + lane];
+        }
+    }
+#else
+    for (size_t n = 0; n < count; ++n) {
+        const BoundingSphere& s = spheres[n];
+        bool inside = true;
+        for (int i = 0; i < 6 && inside; ++i)
+            inside = mPlaneX[i] * s.center.x + mPlaneY[i] * s.center.y + mPlaneZ[i] * s.center.z + mPlaneW[i] >= -s.radius;
+        visible[n] = inside ? 1 : 0;
+        visibleCount += visible[n];
+    }
+#endif
+    return visibleCount;
+}
@@ -6,7 +6,7 @@
 
  CustomCamera::CustomCamera(glm::vec3 position, glm::vec3 up, float yaw, float pitch)
         : mFront(glm::vec3(0.0f, 0.0f, -1.0f)), mMovementSpeed(2.5f),
-        mSensitivity(0.1f), mZoom(90.0f) 
+        mSensitivity(0.1f), mZoom(90.0f), mIpd(0.064f), mConvergence(2.0f)
     {
         mPosition = position;
         mWorldUp = up;
@@ -38,6 +38,16 @@
      return mZoom;
  }
 
+ glm::vec3 CustomCamera::GetFront() const noexcept
+ {
+     return mFront;
+ }
+
+ glm::mat3 CustomCamera::GetViewRotation() const
+ {
+     return glm::mat3(glm::lookAt(glm::vec3(0.0f), mFront, mUp));
+ }
+
 CustomCamera::~CustomCamera()
 {
 }
@@ -46,6 +56,53 @@ glm::mat4 CustomCamera::GetViewMatrix() {
         return glm::lookAt(mPosition, mPosition + mFront, mUp);
     }
 
+void CustomCamera::SetIpd(float val)
+{
+    mIpd = val;
+}
+
+float CustomCamera::GetIpd() const noexcept
+{
+    return mIpd;
+}
+
+void CustomCamera::SetConvergence(float val)
+{
+    mConvergence = val;
+}
+
+float CustomCamera::GetConvergence() const noexcept
+{
+    return mConvergence;
+}
+
+    glm::vec3 CustomCamera::GetEyePosition(StereoEye eye) const {
+        float offset = eye == kMonoEye ? 0.0f : (eye == kLeftEye ? -0.5f : 0.5f) * mIpd;
+        return mPosition + offset * mRight;
+    }
+
+    glm::mat4 CustomCamera::GetEyeViewMatrix(StereoEye eye) const {
+        glm::vec3 position = GetEyePosition(eye);
+        return glm::lookAt(position, position + mFront, mUp);
+    }
+
+    glm::mat4 CustomCamera::GetEyeProjectionMatrix(StereoEye eye, float aspect, float zNear, float zFar) const {
+        float top = zNear * tan(glm::radians(mZoom) * 0.5f);
+        float halfWidth = aspect * top;
+        // the eye's frustum shifts back towards the center by its offset, scaled from the
+        // convergence distance to the near plane
+        float offset = eye == kMonoEye ? 0.0f : (eye == kLeftEye ? -0.5f : 0.5f) * mIpd;
+        float shift = -offset * zNear / mConvergence;
+        return glm::frustum(-halfWidth + shift, halfWidth + shift, -top, top, zNear, zFar);
+    }
+
+    void CustomCamera::GetRay(float ndcX, float ndcY, float aspect, glm::vec3& origin, glm::vec3& direction) const {
+        // matches glm::perspective(radians(mZoom), aspect, ...) with the view matrix above
+        float tanHalfFov = tan(glm::radians(mZoom) * 0.5f);
+        origin = mPosition;
+        direction = glm::normalize(mFront + ndcX * aspect * tanHalfFov * mRight + ndcY * tanHalfFov * mUp);
+    }
+
     void CustomCamera::ProcessKeyboard(int direction, float deltaTime) {
         float velocity = mMovementSpeed * deltaTime;
         if (direction == GLFW_KEY_W)
@@ -107,3 +164,13 @@ glm::mat4 CustomCamera::GetViewMatrix() {
         std::cout << "Current Camera Pitch is: " << mPitch << std::endl;
 
     }
+
+glm::mat4 timewarpMatrix(const glm::mat3& renderRotation, const glm::mat3& latestRotation, const glm::mat4& projection)
+{
+    // view direction d to clip (x, y, w) of the projection, w = -d.z
+    glm::mat3 project(glm::vec3(projection[0][0], 0.0f, 0.0f), glm::vec3(0.0f, projection[1][1], 0.0f),
+        glm::vec3(projection[2][0], projection[2][1], -1.0f));
+    // latest view -> world -> rendered view
+    glm::mat3 delta = renderRotation * glm::transpose(latestRotation);
+    return glm::mat4(project * delta * glm::inverse(project));
+}
@@ -0,0 +1,92 @@
+#include "utils/DistortionMesh.h"
+#include "utils/GLStateCache.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+void DistortionMesh::Build(int columns, int rows, const LensCoverage& covered)
+{
+    const int eyeCount = 2;
+    const int verticesPerEye = (columns + 1) * (rows + 1);
+    mIndicesPerEye = columns * rows * 6;
+
+    std::vector<WarpVertex> vertices;
+    vertices.reserve(size_t(verticesPerEye) * eyeCount);
+    // full grids of both eyes, then the lens cells of both eyes
+    std::vector<unsigned short> indices;
+    indices.reserve(size_t(mIndicesPerEye) * eyeCount * 2);
+    std::vector<unsigned short> lensIndices;
+    std::vector<char> coveredCorners(verticesPerEye);
+    for (int eye = 0; eye < eyeCount; ++eye) {
+        const unsigned short base = static_cast<unsigned short>(vertices.size());
+        for (int row = 0; row <= rows; ++row) {
+            for (int column = 0; column <= columns; ++column) {
+                WarpVertex vertex = {};
+                vertex.position = glm::vec2(float(column) / columns, float(row) / rows);
+                vertex.eye = float(eye);
+                vertices.push_back(vertex);
+                coveredCorners[row * (columns + 1) + column] = covered(eye, vertex.position);
+            }
+        }
+
+        const size_t lensBegin = lensIndices.size();
+        for (int row = 0; row < rows; ++row) {
+            for (int column = 0; column < columns; ++column) {
+                unsigned short corner = static_cast<unsigned short>(base + row * (columns + 1) + column);
+                unsigned short above = static_cast<unsigned short>(corner + columns + 1);
+                const unsigned short quad[6] = { corner, static_cast<unsigned short>(corner + 1), static_cast<unsigned short>(above + 1),
+                    corner, static_cast<unsigned short>(above + 1), above };
+                indices.insert(indices.end(), quad, quad + 6);
+
+                // the covered area can cut through a cell without reaching its corners,
+                // look one cell further
+                bool lens = false;
+                for (int y = std::max(row - 1, 0); y <= std::min(row + 2, rows) && !lens; ++y)
+                    for (int x = std::max(column - 1, 0); x <= std::min(column + 2, columns) && !lens; ++x)
+                        lens = coveredCorners[y * (columns + 1) + x] != 0;
+                if (lens)
+                    lensIndices.insert(lensIndices.end(), quad, quad + 6);
+            }
+        }
+        mLensIndices[eye] = static_cast<int>(lensIndices.size() - lensBegin);
+    }
+    indices.insert(indices.end(), lensIndices.begin(), lensIndices.end());
+
+    if (!mVertexArray) {
+        mVertexArray = GLVertexArray::Create();
+        mVertexBuffer = GLBuffer::Create();
+        mIndexBuffer = GLBuffer::Create();
+    }
+    GLStateCache::BindVertexArray(mVertexArray.Get());
+    GLStateCache::BindBuffer(GL_ARRAY_BUFFER, mVertexBuffer.Get());
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(WarpVertex), vertices.data(), GL_STATIC_DRAW);
+    GLStateCache::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer.Get());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), indices.data(), GL_STATIC_DRAW);
+
+    const int stride = sizeof(WarpVertex);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(WarpVertex, position));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(WarpVertex, eye));
+    glEnableVertexAttribArray(1);
+    GLStateCache::BindVertexArray(0);
+}
+
+void DistortionMesh::Draw(int eyeCount, bool lensCells) const
+{
+    GLStateCache::BindVertexArray(mVertexArray.Get());
+    if (!lensCells) {
+        glDrawElements(GL_TRIANGLES, mIndicesPerEye * eyeCount, GL_UNSIGNED_SHORT, 0);
+        return;
+    }
+    int count = mLensIndices[0] + (eyeCount > 1 ? mLensIndices[1] : 0);
+    const size_t first = size_t(mIndicesPerEye) * 2;
+    glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_SHORT, (void*)(first * sizeof(unsigned short)));
+}
+
+void DistortionMesh::Release()
+{
+    mVertexArray.Reset();
+    mVertexBuffer.Reset();
+    mIndexBuffer.Reset();
+}
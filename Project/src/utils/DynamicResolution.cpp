@@ -0,0 +1,45 @@
+#include "utils/DynamicResolution.h"
+#include <algorithm>
+
+constexpr float DynamicResolution::kStep;
+constexpr float DynamicResolution::kDownLoad;
+constexpr int DynamicResolution::kDownFrames;
+constexpr float DynamicResolution::kUpLoad;
+constexpr int DynamicResolution::kUpFrames;
+
+DynamicResolution::DynamicResolution(float budgetMs, float minScale, float maxScale)
+    : mBudgetMs(budgetMs), mMinScale(minScale), mMaxScale(maxScale), mScale(maxScale)
+{
+}
+
+bool DynamicResolution::Update(float gpuMs)
+{
+    mAverageMs = mAverageMs > 0.0f ? mAverageMs + 0.1f * (gpuMs - mAverageMs) : gpuMs;
+
+    // counters only run on consecutive frames, a single spike or dip resets the other side
+    if (gpuMs > kDownLoad * mBudgetMs) {
+        ++mOverFrames;
+        mUnderFrames = 0;
+    }
+    else if (gpuMs < kUpLoad * mBudgetMs) {
+        ++mUnderFrames;
+        mOverFrames = 0;
+    }
+    else {
+        mOverFrames = 0;
+        mUnderFrames = 0;
+    }
+
+    float scale = mScale;
+    if (mOverFrames >= kDownFrames)
+        scale = std::max(mMinScale, mScale - kStep);
+    else if (mUnderFrames >= kUpFrames)
+        scale = std::min(mMaxScale, mScale + kStep);
+
+    if (scale == mScale)
+        return false;
+    mScale = scale;
+    mOverFrames = 0;
+    mUnderFrames = 0;
+    return true;
+}
@@ -0,0 +1,88 @@
+#include "utils/GLObject.h"
+#include "utils/GLStateCache.h"
+#include <glad/glad.h>
+#include <atomic>
+#include <iostream>
+
+namespace {
+
+    std::atomic<int> liveObjects[static_cast<int>(GLObjectType::Count)];
+}
+
+unsigned int createGLObject(GLObjectType type)
+{
+    unsigned int id = 0;
+    switch (type) {
+    case GLObjectType::Texture: glGenTextures(1, &id); break;
+    case GLObjectType::Buffer: glGenBuffers(1, &id); break;
+    case GLObjectType::VertexArray: glGenVertexArrays(1, &id); break;
+    case GLObjectType::Framebuffer: glGenFramebuffers(1, &id); break;
+    case GLObjectType::Renderbuffer: glGenRenderbuffers(1, &id); break;
+    case GLObjectType::Program: id = glCreateProgram(); break;
+    default: break;
+    }
+    return id;
+}
+
+void deleteGLObject(GLObjectType type, unsigned int id)
+{
+    GLStateCache::OnDelete(type, id);
+    switch (type) {
+    case GLObjectType::Texture: glDeleteTextures(1, &id); break;
+    case GLObjectType::Buffer: glDeleteBuffers(1, &id); break;
+    case GLObjectType::VertexArray: glDeleteVertexArrays(1, &id); break;
+    case GLObjectType::Framebuffer: glDeleteFramebuffers(1, &id); break;
+    case GLObjectType::Renderbuffer: glDeleteRenderbuffers(1, &id); break;
+    case GLObjectType::Program: glDeleteProgram(id); break;
+    default: break;
+    }
+}
+
+void GLObjectTracker::OnCreate(GLObjectType type)
+{
+    ++liveObjects[static_cast<int>(type)];
+}
+
+void GLObjectTracker::OnDestroy(GLObjectType type)
+{
+    --liveObjects[static_cast<int>(type)];
+}
+
+int GLObjectTracker::LiveCount(GLObjectType type)
+{
+    return liveObjects[static_cast<int>(type)];
+}
+
+int GLObjectTracker::LiveCount()
+{
+    int count = 0;
+    for (int t = 0; t < static_cast<int>(GLObjectType::Count); ++t)
+        count += liveObjects[t];
+    return count;
+}
+
+const char* GLObjectTracker::TypeName(GLObjectType type)
+{
+    switch (type) {
+    case GLObjectType::Texture: return "texture";
+    case GLObjectType::Buffer: return "buffer";
+    case GLObjectType::VertexArray: return "vertex array";
+    case GLObjectType::Framebuffer: return "framebuffer";
+    case GLObjectType::Renderbuffer: return "renderbuffer";
+    case GLObjectType::Program: return "program";
+    default: return "unknown";
+    }
+}
+
+bool GLObjectTracker::ReportLeaks()
+{
+    bool clean = true;
+    for (int t = 0; t < static_cast<int>(GLObjectType::Count); ++t) {
+        if (liveObjects[t] != 0) {
+            std::cerr << "GL leak: " << liveObjects[t] << " " << TypeName(static_cast<GLObjectType>(t))
+                << " object(s) still alive at shutdown" << std::endl;
+            clean = false;
+        }
+    }
+    return clean;
+}
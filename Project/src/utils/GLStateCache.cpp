@@ -0,0 +1,300 @@
+#include "utils/GLStateCache.h"
+#include <glad/glad.h>
+
+namespace {
+
+    // cached value that has to go to GL whatever it is
+    const unsigned int kUnknown = 0xFFFFFFFFu;
+
+    const int kTextureUnits = 32;
+    const int kBufferTargets = 16;
+    const int kIndexedBindings = 32;
+    const int kCapabilities = 16;
+
+    struct TextureBinding {
+        unsigned int target = kUnknown;
+        unsigned int texture = kUnknown;
+    };
+
+    struct BufferBinding {
+        unsigned int target = 0;
+        unsigned int buffer = kUnknown;
+    };
+
+    struct IndexedBinding {
+        unsigned int target = 0;
+        unsigned int index = 0;
+        unsigned int buffer = kUnknown;
+        std::ptrdiff_t offset = 0;
+        std::ptrdiff_t size = 0;
+    };
+
+    struct Capability {
+        unsigned int capability = 0;
+        unsigned int enabled = kUnknown;
+    };
+
+    struct State {
+        unsigned int program = kUnknown;
+        unsigned int activeTexture = kUnknown;
+        TextureBinding textures[kTextureUnits];
+        unsigned int vertexArray = kUnknown;
+        unsigned int drawFramebuffer = kUnknown;
+        unsigned int readFramebuffer = kUnknown;
+        BufferBinding buffers[kBufferTargets];
+        int bufferCount = 0;
+        IndexedBinding indexed[kIndexedBindings];
+        int indexedCount = 0;
+        Capability capabilities[kCapabilities];
+        int capabilityCount = 0;
+        unsigned int cullFace = kUnknown;
+        unsigned int depthFunc = kUnknown;
+    };
+
+    State state;
+    GLStateStats currentFrame;
+    GLStateStats lastFrame;
+
+    // true when value already holds next, otherwise value becomes next
+    bool filter(unsigned int& value, unsigned int next)
+    {
+        if (value == next) {
+            ++currentFrame.filtered;
+            return true;
+        }
+        value = next;
+        ++currentFrame.submitted;
+        return false;
+    }
+
+    // slot of target, a new one when it is not tracked yet, nullptr when the table is full
+    BufferBinding* bufferSlot(unsigned int target)
+    {
+        for (int i = 0; i < state.bufferCount; ++i)
+            if (state.buffers[i].target == target)
+                return &state.buffers[i];
+        if (state.bufferCount == kBufferTargets)
+            return nullptr;
+        BufferBinding& slot = state.buffers[state.bufferCount++];
+        slot.target = target;
+        slot.buffer = kUnknown;
+        return &slot;
+    }
+
+    IndexedBinding* indexedSlot(unsigned int target, unsigned int index)
+    {
+        for (int i = 0; i < state.indexedCount; ++i)
+            if (state.indexed[i].target == target && state.indexed[i].index == index)
+                return &state.indexed[i];
+        if (state.indexedCount == kIndexedBindings)
+            return nullptr;
+        IndexedBinding& slot = state.indexed[state.indexedCount++];
+        slot.target = target;
+        slot.index = index;
+        slot.buffer = kUnknown;
+        return &slot;
+    }
+
+    Capability* capabilitySlot(unsigned int capability)
+    {
+        for (int i = 0; i < state.capabilityCount; ++i)
+            if (state.capabilities[i].capability == capability)
+                return &state.capabilities[i];
+        if (state.capabilityCount == kCapabilities)
+            return nullptr;
+        Capability& slot = state.capabilities[state.capabilityCount++];
+        slot.capability = capability;
+        slot.enabled = kUnknown;
+        return &slot;
+    }
+
+    // indexed binding, size 0 stands for glBindBufferBase
+    void bindIndexed(unsigned int target, unsigned int index, unsigned int buffer,
+        std::ptrdiff_t offset, std::ptrdiff_t size)
+    {
+        IndexedBinding* slot = indexedSlot(target, index);
+        if (slot && slot->buffer == buffer && slot->offset == offset && slot->size == size) {
+            ++currentFrame.filtered;
+            return;
+        }
+        if (slot) {
+            slot->buffer = buffer;
+            slot->offset = offset;
+            slot->size = size;
+        }
+        ++currentFrame.submitted;
+        if (size == 0)
+            glBindBufferBase(target, index, buffer);
+        else
+            glBindBufferRange(target, index, buffer, offset, size);
+
+        // the generic binding point follows
+        if (BufferBinding* generic = bufferSlot(target))
+            generic->buffer = buffer;
+    }
+}
+
+void GLStateCache::UseProgram(unsigned int program)
+{
+    if (!filter(state.program, program))
+        glUseProgram(program);
+}
+
+void GLStateCache::ActiveTexture(unsigned int texture)
+{
+    if (!filter(state.activeTexture, texture))
+        glActiveTexture(texture);
+}
+
+void GLStateCache::BindTexture(unsigned int target, unsigned int texture)
+{
+    int unit = state.activeTexture == kUnknown ? -1 : static_cast<int>(state.activeTexture - GL_TEXTURE0);
+    if (unit < 0 || unit >= kTextureUnits) {
+        // unknown unit, can't say what is bound there
+        ++currentFrame.submitted;
+        glBindTexture(target, texture);
+        return;
+    }
+
+    TextureBinding& binding = state.textures[unit];
+    if (binding.target == target && binding.texture == texture) {
+        ++currentFrame.filtered;
+        return;
+    }
+    binding.target = target;
+    binding.texture = texture;
+    ++currentFrame.submitted;
+    glBindTexture(target, texture);
+}
+
+void GLStateCache::BindVertexArray(unsigned int vertexArray)
+{
+    if (filter(state.vertexArray, vertexArray))
+        return;
+    glBindVertexArray(vertexArray);
+    if (BufferBinding* elements = bufferSlot(GL_ELEMENT_ARRAY_BUFFER))
+        elements->buffer = kUnknown;
+}
+
+void GLStateCache::BindFramebuffer(unsigned int target, unsigned int framebuffer)
+{
+    bool drawCached = state.drawFramebuffer == framebuffer;
+    bool readCached = state.readFramebuffer == framebuffer;
+    bool cached = target == GL_DRAW_FRAMEBUFFER ? drawCached
+        : target == GL_READ_FRAMEBUFFER ? readCached
+        : drawCached && readCached;
+    if (cached) {
+        ++currentFrame.filtered;
+        return;
+    }
+    if (target != GL_READ_FRAMEBUFFER)
+        state.drawFramebuffer = framebuffer;
+    if (target != GL_DRAW_FRAMEBUFFER)
+        state.readFramebuffer = framebuffer;
+    ++currentFrame.submitted;
+    glBindFramebuffer(target, framebuffer);
+}
+
+void GLStateCache::BindBuffer(unsigned int target, unsigned int buffer)
+{
+    BufferBinding* slot = bufferSlot(target);
+    if (slot && filter(slot->buffer, buffer))
+        return;
+    if (!slot)
+        ++currentFrame.submitted;
+    glBindBuffer(target, buffer);
+}
+
+void GLStateCache::BindBufferBase(unsigned int target, unsigned int index, unsigned int buffer)
+{
+    bindIndexed(target, index, buffer, 0, 0);
+}
+
+void GLStateCache::BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer,
+    std::ptrdiff_t offset, std::ptrdiff_t size)
+{
+    bindIndexed(target, index, buffer, offset, size);
+}
+
+void GLStateCache::Enable(unsigned int capability)
+{
+    Capability* slot = capabilitySlot(capability);
+    if (slot && filter(slot->enabled, GL_TRUE))
+        return;
+    if (!slot)
+        ++currentFrame.submitted;
+    glEnable(capability);
+}
+
+void GLStateCache::Disable(unsigned int capability)
+{
+    Capability* slot = capabilitySlot(capability);
+    if (slot && filter(slot->enabled, GL_FALSE))
+        return;
+    if (!slot)
+        ++currentFrame.submitted;
+    glDisable(capability);
+}
+
+void GLStateCache::CullFace(unsigned int mode)
+{
+    if (!filter(state.cullFace, mode))
+        glCullFace(mode);
+}
+
+void GLStateCache::DepthFunc(unsigned int func)
+{
+    if (!filter(state.depthFunc, func))
+        glDepthFunc(func);
+}
+
+void GLStateCache::Invalidate()
+{
+    state = State();
+}
+
+void GLStateCache::OnDelete(GLObjectType type, unsigned int id)
+{
+    switch (type) {
+    case GLObjectType::Texture:
+        for (TextureBinding& binding : state.textures)
+            if (binding.texture == id)
+                binding.texture = kUnknown;
+        break;
+    case GLObjectType::Buffer:
+        for (int i = 0; i < state.bufferCount; ++i)
+            if (state.buffers[i].buffer == id)
+                state.buffers[i].buffer = kUnknown;
+        for (int i = 0; i < state.indexedCount; ++i)
+            if (state.indexed[i].buffer == id)
+                state.indexed[i].buffer = kUnknown;
+        break;
+    case GLObjectType::VertexArray:
+        if (state.vertexArray == id)
+            state.vertexArray = kUnknown;
+        break;
+    case GLObjectType::Framebuffer:
+        if (state.drawFramebuffer == id)
+            state.drawFramebuffer = kUnknown;
+        if (state.readFramebuffer == id)
+            state.readFramebuffer = kUnknown;
+        break;
+    case GLObjectType::Program:
+        if (state.program == id)
+            state.program = kUnknown;
+        break;
+    default:
+        break;
+    }
+}
+
+void GLStateCache::BeginFrame()
+{
+    lastFrame = currentFrame;
+    currentFrame = GLStateStats();
+}
+
+GLStateStats GLStateCache::GetFrameStats()
+{
+    return lastFrame;
+}
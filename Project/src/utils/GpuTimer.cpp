@@ -0,0 +1,132 @@
+#include "utils/GpuTimer.h"
+#include <glad/glad.h>
+
+float measureGpuTime(const std::function<void()>& work, int iterations)
+{
+    unsigned int query;
+    glGenQueries(1, &query);
+
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    for (int i = 0; i < iterations; ++i)
+        work();
+    glEndQuery(GL_TIME_ELAPSED);
+
+    GLuint64 elapsedNs = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedNs);
+    glDeleteQueries(1, &query);
+
+    return float(elapsedNs) / 1.0e6f / float(iterations > 0 ? iterations : 1);
+}
+
+GpuFrameTimer::GpuFrameTimer(int latency)
+    : mQueries(2 * latency, 0), mPending(latency, false)
+{
+    glGenQueries(static_cast<GLsizei>(mQueries.size()), mQueries.data());
+}
+
+GpuFrameTimer::~GpuFrameTimer()
+{
+    Release();
+}
+
+void GpuFrameTimer::Begin()
+{
+    // the GPU is more than latency frames behind, give up on the oldest result
+    if (mPending[mWriteSlot]) {
+        mPending[mWriteSlot] = false;
+        mReadSlot = (mWriteSlot + 1) % static_cast<int>(mPending.size());
+    }
+    glQueryCounter(mQueries[2 * mWriteSlot], GL_TIMESTAMP);
+}
+
+void GpuFrameTimer::End()
+{
+    glQueryCounter(mQueries[2 * mWriteSlot + 1], GL_TIMESTAMP);
+    mPending[mWriteSlot] = true;
+    mWriteSlot = (mWriteSlot + 1) % static_cast<int>(mPending.size());
+}
+
+bool GpuFrameTimer::Poll(float& ms)
+{
+    bool found = false;
+    while (mPending[mReadSlot]) {
+        GLint available = 0;
+        glGetQueryObjectiv(mQueries[2 * mReadSlot + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(mQueries[2 * mReadSlot], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(mQueries[2 * mReadSlot + 1], GL_QUERY_RESULT, &end);
+        ms = float(end - start) / 1.0e6f;
+        found = true;
+
+        mPending[mReadSlot] = false;
+        mReadSlot = (mReadSlot + 1) % static_cast<int>(mPending.size());
+    }
+    return found;
+}
+
+void GpuFrameTimer::Release()
+{
+    if (!mQueries.empty() && mQueries[0])
+        glDeleteQueries(static_cast<GLsizei>(mQueries.size()), mQueries.data());
+    mQueries.assign(mQueries.size(), 0);
+    mPending.assign(mPending.size(), false);
+}
+
+InputLatencyMeter::InputLatencyMeter(int latency)
+    : mQueries(latency, 0), mInputTimes(latency, 0.0), mPending(latency, false)
+{
+    glGenQueries(static_cast<GLsizei>(mQueries.size()), mQueries.data());
+}
+
+InputLatencyMeter::~InputLatencyMeter()
+{
+    Release();
+}
+
+void InputLatencyMeter::Mark(double inputTime, double cpuNow)
+{
+    // the GL_TIMESTAMP get is the GPU clock now, the query below is when the GPU gets there
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    mGpuToCpu = cpuNow - double(gpuNow) / 1.0e9;
+
+    if (mPending[mWriteSlot]) {
+        mPending[mWriteSlot] = false;
+        mReadSlot = (mWriteSlot + 1) % static_cast<int>(mPending.size());
+    }
+    glQueryCounter(mQueries[mWriteSlot], GL_TIMESTAMP);
+    mInputTimes[mWriteSlot] = inputTime;
+    mPending[mWriteSlot] = true;
+    mWriteSlot = (mWriteSlot + 1) % static_cast<int>(mPending.size());
+}
+
+bool InputLatencyMeter::Poll(float& ms)
+{
+    bool found = false;
+    while (mPending[mReadSlot]) {
+        GLint available = 0;
+        glGetQueryObjectiv(mQueries[mReadSlot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+
+        GLuint64 done = 0;
+        glGetQueryObjectui64v(mQueries[mReadSlot], GL_QUERY_RESULT, &done);
+        ms = float((double(done) / 1.0e9 + mGpuToCpu - mInputTimes[mReadSlot]) * 1000.0);
+        found = true;
+
+        mPending[mReadSlot] = false;
+        mReadSlot = (mReadSlot + 1) % static_cast<int>(mPending.size());
+    }
+    return found;
+}
+
+void InputLatencyMeter::Release()
+{
+    if (!mQueries.empty() && mQueries[0])
+        glDeleteQueries(static_cast<GLsizei>(mQueries.size()), mQueries.data());
+    mQueries.assign(mQueries.size(), 0);
+    mPending.assign(mPending.size(), false);
+}
@@ -0,0 +1,368 @@
+#ifdef VR_HEADLESS
+
+#include "utils/AppWindow.h"
+#include "utils/GLStateCache.h"
+#include <glad/glad.h>
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+// key codes only, nothing of GLFW is linked
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+namespace {
+    // one line of the input script
+    struct ScriptEvent {
+        enum Type { Key, Mouse, Look, Scroll };
+        int first = 0, last = 0; // frames, inclusive
+        Type type = Key;
+        int code = 0;            // key / mouse button
+        double x = 0.0, y = 0.0; // cursor movement per frame, scroll offset
+    };
+
+    int keyCode(const std::string& name)
+    {
+        struct Named { const char* name; int code; };
+        static const Named keys[] = {
+            { "SPACE", GLFW_KEY_SPACE }, { "ESCAPE", GLFW_KEY_ESCAPE }, { "BACKSPACE", GLFW_KEY_BACKSPACE },
+            { "LEFT_SHIFT", GLFW_KEY_LEFT_SHIFT }, { "UP", GLFW_KEY_UP }, { "DOWN", GLFW_KEY_DOWN },
+            { "LEFT", GLFW_KEY_LEFT }, { "RIGHT", GLFW_KEY_RIGHT }, { "PAGE_UP", GLFW_KEY_PAGE_UP },
+            { "PAGE_DOWN", GLFW_KEY_PAGE_DOWN }
+        };
+        for (const Named& key : keys)
+            if (name == key.name)
+                return key.code;
+        // letters and digits are their upper case ASCII code, like GLFW_KEY_A and GLFW_KEY_1
+        if (name.size() == 1 && std::isalnum(static_cast<unsigned char>(name[0])))
+            return std::toupper(static_cast<unsigned char>(name[0]));
+        return -1;
+    }
+
+    // Lines of "frame[-lastFrame] event values", # starts a comment:
+    //   0-59    key    W       hold W for the first 60 frames (names: UP, PAGE_UP, SPACE, ...)
+    //   60      key    4       press 4 on frame 60
+    //   10      mouse  0       left button down on frame 10
+    //   30-90   look   3 0     move the cursor 3 pixels right per frame
+    //   120     scroll 1
+    bool loadScript(const std::string& path, std::vector<ScriptEvent>& events)
+    {
+        std::ifstream file(path);
+        if (!file) {
+            std::cerr << "Cannot open input script " << path << std::endl;
+            return false;
+        }
+
+        std::string line;
+        for (int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+            line = line.substr(0, line.find('#'));
+            std::istringstream tokens(line);
+            std::string frames, type;
+            if (!(tokens >> frames))
+                continue;
+
+            ScriptEvent event;
+            bool ok = static_cast<bool>(tokens >> type);
+            if (ok && std::sscanf(frames.c_str(), "%d-%d", &event.first, &event.last) != 2) {
+                ok = std::sscanf(frames.c_str(), "%d", &event.first) == 1;
+                event.last = event.first;
+            }
+            if (ok && type == "key") {
+                std::string name;
+                event.type = ScriptEvent::Key;
+                ok = static_cast<bool>(tokens >> name) && (event.code = keyCode(name)) >= 0;
+            }
+            else if (ok && type == "mouse") {
+                event.type = ScriptEvent::Mouse;
+                ok = static_cast<bool>(tokens >> event.code);
+            }
+            else if (ok && type == "look") {
+                event.type = ScriptEvent::Look;
+                ok = static_cast<bool>(tokens >> event.x >> event.y);
+            }
+            else if (ok && type == "scroll") {
+                event.type = ScriptEvent::Scroll;
+                ok = static_cast<bool>(tokens >> event.y);
+            }
+            else
+                ok = false;
+
+            if (!ok || event.last < event.first) {
+                std::cerr << path << ":" << lineNumber << ": expected \"frame[-lastFrame] key|mouse|look|scroll values\"" << std::endl;
+                return false;
+            }
+            events.push_back(event);
+        }
+        return true;
+    }
+}
+
+struct AppWindow::Backend {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    // stands in for the window's default framebuffer
+    GLFramebuffer framebuffer;
+    GLRenderbuffer colorBuffer;
+    GLRenderbuffer depthBuffer;
+    int width = 0, height = 0;
+
+    int frameCount = 0;
+    int frame = 0;
+    int polledFrame = -1;
+    bool shouldClose = false;
+    double fixedTimeStep = 0.0;
+    std::chrono::steady_clock::time_point start;
+    std::string outputPath;
+
+    std::vector<ScriptEvent> script;
+    double cursorX = 0.0, cursorY = 0.0;
+    CursorPosCallback cursorPosCallback = nullptr;
+    ScrollCallback scrollCallback = nullptr;
+
+    bool isDown(ScriptEvent::Type type, int code) const
+    {
+        for (const ScriptEvent& event : script)
+            if (event.type == type && event.code == code && frame >= event.first && frame <= event.last)
+                return true;
+        return false;
+    }
+
+    // the output path is no format string, only a literal %d is replaced
+    bool everyFrame() const { return outputPath.find("%d") != std::string::npos; }
+
+    void writeFrame() const
+    {
+        std::string path = outputPath;
+        size_t number = path.find("%d");
+        if (number != std::string::npos)
+            path.replace(number, 2, std::to_string(frame));
+
+        std::vector<unsigned char> pixels(size_t(width) * height * 3);
+        GLStateCache::BindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer.Get());
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+        // PPM rows go top down, GL's bottom up
+        std::ofstream file(path, std::ios::binary);
+        file << "P6\n" << width << " " << height << "\n255\n";
+        for (int row = height - 1; row >= 0; --row)
+            file.write(reinterpret_cast<const char*>(&pixels[size_t(row) * width * 3]), size_t(width) * 3);
+        if (!file)
+            std::cerr << "Cannot write frame " << path << std::endl;
+    }
+};
+
+AppWindow::AppWindow() : mBackend(new Backend()) {}
+
+AppWindow::~AppWindow()
+{
+    Destroy();
+}
+
+bool AppWindow::Create(const AppWindowDesc& desc)
+{
+    Backend& backend = *mBackend;
+    if (!desc.inputScript.empty() && !loadScript(desc.inputScript, backend.script))
+        return false;
+
+    // no window system at all, Mesa's surfaceless platform when there is one
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+        backend.display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (backend.display == EGL_NO_DISPLAY)
+        backend.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major = 0, minor = 0;
+    if (backend.display == EGL_NO_DISPLAY || !eglInitialize(backend.display, &major, &minor)
+        || !eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "EGL Init Failed!! (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        return false;
+    }
+
+    const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    eglChooseConfig(backend.display, configAttributes, &config, 1, &configCount);
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    backend.context = eglCreateContext(backend.display, configCount > 0 ? config : (EGLConfig)0,
+        EGL_NO_CONTEXT, contextAttributes);
+    // surfaceless: no default framebuffer, the offscreen one below takes its place
+    if (backend.context == EGL_NO_CONTEXT
+        || !eglMakeCurrent(backend.display, EGL_NO_SURFACE, EGL_NO_SURFACE, backend.context)) {
+        std::cerr << "EGL context creation failed!! (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        Destroy();
+        return false;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        std::cerr << "GLAD Loaded Failed!!" << std::endl;
+        Destroy();
+        return false;
+    }
+
+    backend.width = desc.width;
+    backend.height = desc.height;
+    backend.colorBuffer = GLRenderbuffer::Create();
+    glBindRenderbuffer(GL_RENDERBUFFER, backend.colorBuffer.Get());
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, backend.width, backend.height);
+    backend.depthBuffer = GLRenderbuffer::Create();
+    glBindRenderbuffer(GL_RENDERBUFFER, backend.depthBuffer.Get());
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, backend.width, backend.height);
+
+    backend.framebuffer = GLFramebuffer::Create();
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, backend.framebuffer.Get());
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, backend.colorBuffer.Get());
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, backend.depthBuffer.Get());
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Headless back buffer is incomplete" << std::endl;
+        Destroy();
+        return false;
+    }
+
+    // nothing can close a headless run, it always has a fixed frame count
+    backend.frameCount = desc.frameCount > 0 ? desc.frameCount : 1;
+    backend.fixedTimeStep = desc.fixedTimeStep;
+    backend.outputPath = desc.outputPath;
+    backend.start = std::chrono::steady_clock::now();
+    std::cout << "Headless " << backend.width << "x" << backend.height << " on EGL " << major << "." << minor
+        << ", " << glGetString(GL_RENDERER) << std::endl;
+    return true;
+}
+
+void AppWindow::Destroy()
+{
+    Backend& backend = *mBackend;
+    if (backend.display == EGL_NO_DISPLAY)
+        return;
+
+    // while the context is still current
+    backend.framebuffer.Reset();
+    backend.colorBuffer.Reset();
+    backend.depthBuffer.Reset();
+    eglMakeCurrent(backend.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (backend.context != EGL_NO_CONTEXT)
+        eglDestroyContext(backend.display, backend.context);
+    eglTerminate(backend.display);
+    backend.context = EGL_NO_CONTEXT;
+    backend.display = EGL_NO_DISPLAY;
+}
+
+bool AppWindow::ShouldClose() const
+{
+    return mBackend->shouldClose || (mBackend->frameCount > 0 && mBackend->frame >= mBackend->frameCount);
+}
+
+void AppWindow::SetShouldClose(bool close)
+{
+    mBackend->shouldClose = close;
+}
+
+void AppWindow::SetTitle(const std::string& title)
+{
+    // no title bar, the stats go to the log
+    std::cout << title << std::endl;
+}
+
+void AppWindow::SwapBuffers()
+{
+    Backend& backend = *mBackend;
+    // every frame with a %d in the path, otherwise the last one
+    if (!backend.outputPath.empty() && (backend.everyFrame() || backend.frame == backend.frameCount - 1))
+        backend.writeFrame();
+    glFlush();
+    ++backend.frame;
+}
+
+void AppWindow::PollEvents()
+{
+    // the late pose latch and the timewarp poll again within a frame, the script moves once
+    Backend& backend = *mBackend;
+    if (backend.polledFrame == backend.frame)
+        return;
+    backend.polledFrame = backend.frame;
+
+    // a window reports the cursor once it is captured, the camera takes that as its origin
+    bool moved = backend.frame == 0;
+    for (const ScriptEvent& event : backend.script) {
+        if (backend.frame < event.first || backend.frame > event.last)
+            continue;
+        if (event.type == ScriptEvent::Look) {
+            backend.cursorX += event.x;
+            backend.cursorY += event.y;
+            moved = true;
+        }
+        else if (event.type == ScriptEvent::Scroll && backend.scrollCallback)
+            backend.scrollCallback(event.y);
+    }
+    if (moved && backend.cursorPosCallback)
+        backend.cursorPosCallback(backend.cursorX, backend.cursorY);
+}
+
+bool AppWindow::IsKeyDown(int key) const
+{
+    return mBackend->isDown(ScriptEvent::Key, key);
+}
+
+bool AppWindow::IsMouseButtonDown(int button) const
+{
+    return mBackend->isDown(ScriptEvent::Mouse, button);
+}
+
+double AppWindow::GetTime() const
+{
+    const Backend& backend = *mBackend;
+    if (backend.fixedTimeStep > 0.0)
+        return backend.frame * backend.fixedTimeStep;
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - backend.start).count();
+}
+
+void AppWindow::GetFramebufferSize(int& width, int& height) const
+{
+    width = mBackend->width;
+    height = mBackend->height;
+}
+
+unsigned int AppWindow::GetBackbuffer() const
+{
+    return mBackend->framebuffer.Get();
+}
+
+void* AppWindow::GetProcAddress(const char* name) const
+{
+    return reinterpret_cast<void*>(eglGetProcAddress(name));
+}
+
+void AppWindow::SetFramebufferSizeCallback(FramebufferSizeCallback)
+{
+    // fixed size, never resized
+}
+
+void AppWindow::SetCursorPosCallback(CursorPosCallback callback)
+{
+    mBackend->cursorPosCallback = callback;
+}
+
+void AppWindow::SetScrollCallback(ScrollCallback callback)
+{
+    mBackend->scrollCallback = callback;
+}
+
+#endif
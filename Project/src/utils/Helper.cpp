@@ -1,74 +1,40 @@
 #include "utils/Helper.h"
+#include "utils/BezierSurface.h"
+#include "utils/MeshOptimizer.h"
+#include "utils/GLStateCache.h"
+#include "utils/SceneBatch.h"
 #include <glad/glad.h>
 #include <random>
 #include <iostream>
+#include <algorithm>
+#include <thread>
+#include <cstring>
 
 namespace {
 
-    // bezier surface
-
-    void GenerateControlPoints4x4(glm::vec3 controlPoints[4][4])
+    template <typename Index>
+    void writeGridIndices(int segmentsU, int segmentsV, int bandWidth, Index* indices)
     {
-        float R = 2.0f, H = 1.0f, angle = glm::half_pi<float>(); // 90°
-        //glm::vec3 controlPoints[4][4];
-
-        for (int i = 0; i < 4; ++i) {
-            float u = float(i) / 3;
-            float theta = -angle / 2 + u * angle; // -45°到+45°
-            float x = R * sin(theta);
-            for (int j = 0; j < 4; ++j) {
-                float v = float(j) / 3;
-                float y = -H / 2 + v * H;
-                float z = R * (1 - cos(theta));
-                controlPoints[i][j] = glm::vec3(x, y, z);
+        if (bandWidth <= 0)
+            bandWidth = segmentsV;
+
+        const int rowVerts = segmentsV + 1;
+        for (int band = 0; band < segmentsV; band += bandWidth) {
+            int bandEnd = std::min(band + bandWidth, segmentsV);
+            for (int i = 0; i < segmentsU; ++i) {
+                for (int j = band; j < bandEnd; ++j) {
+                    Index idx = Index(i * rowVerts + j);
+                    *indices++ = idx;
+                    *indices++ = Index(idx + rowVerts);
+                    *indices++ = Index(idx + rowVerts + 1);
+
+                    *indices++ = idx;
+                    *indices++ = Index(idx + rowVerts + 1);
+                    *indices++ = Index(idx + 1);
+                }
             }
         }
     }
-
-
-    float bernstein(int i, float t) {
-        switch(i) {
-            case 0: return (1-t)*(1-t)*(1-t);
-            case 1: return 3*t*(1-t)*(1-t);
-            case 2: return 3*t*t*(1-t);
-            case 3: return t*t*t;
-        }
-        return 0;
-    }
-
-    glm::vec3 bezierSurfacePoint(const glm::vec3 cp[4][4], float u, float v) {
-        glm::vec3 p(0.0f);
-        for (int i = 0; i < 4; ++i)
-            for (int j = 0; j < 4; ++j)
-                p += bernstein(i, u) * bernstein(j, v) * cp[i][j];
-        return p;
-    }
-
-    float bernsteinDeriv(int i, float t) {
-        switch(i) {
-            case 0: return -3*(1-t)*(1-t);
-            case 1: return 3*(1-t)*(1-t) - 6*t*(1-t);
-            case 2: return 6*t*(1-t) - 3*t*t;
-            case 3: return 3*t*t;
-        }
-        return 0;
-    }
-    
-    glm::vec3 bezierSurfaceTangentU(const glm::vec3 cp[4][4], float u, float v) {
-        glm::vec3 p(0.0f);
-        for (int i = 0; i < 4; ++i)
-            for (int j = 0; j < 4; ++j)
-                p += bernsteinDeriv(i, u) * bernstein(j, v) * cp[i][j];
-        return p;
-    }
-
-    glm::vec3 bezierSurfaceTangentV(const glm::vec3 cp[4][4], float u, float v) {
-        glm::vec3 p(0.0f);
-        for (int i = 0; i < 4; ++i)
-            for (int j = 0; j < 4; ++j)
-                p += bernstein(i, u) * bernsteinDeriv(j, v) * cp[i][j];
-        return p;
-    }
 }
 
 // Compile shaders
@@ -111,28 +77,59 @@ unsigned int createShaderProgram(const char* vertexSource, const char* fragmentS
     return shaderProgram;
 }
 
-// create full screen
-void createQuad(unsigned int& quadVAO, unsigned int& quadVBO) {
-    float quadVertices[] = {
-        // positions   // texCoords
-        -1.0f,  1.0f,  0.0f, 1.0f,
-        -1.0f, -1.0f,  0.0f, 0.0f,
-         1.0f, -1.0f,  1.0f, 0.0f,
-
-        -1.0f,  1.0f,  0.0f, 1.0f,
-         1.0f, -1.0f,  1.0f, 0.0f,
-         1.0f,  1.0f,  1.0f, 1.0f
+std::string shaderVariant(const char* source, const char* header) {
+    std::string variant = source;
+    size_t version = variant.find("#version");
+    size_t lineEnd = version == std::string::npos ? std::string::npos : variant.find('\n', version);
+    if (lineEnd == std::string::npos) {
+        std::cerr << "Shader variant: no #version line to put the header after" << std::endl;
+        return variant;
+    }
+    variant.insert(lineEnd + 1, std::string(header) + "\n");
+    return variant;
+}
+
+bool hasGLExtension(const char* name) {
+    int count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (int i = 0; i < count; ++i) {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && std::strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+void createProxyCube(unsigned int& cubeVAO, unsigned int& cubeVBO) {
+    // counter-clockwise seen from outside
+    float cubeVertices[] = {
+        // -z
+        -1.0f, -1.0f, -1.0f,   1.0f,  1.0f, -1.0f,   1.0f, -1.0f, -1.0f,
+         1.0f,  1.0f, -1.0f,  -1.0f, -1.0f, -1.0f,  -1.0f,  1.0f, -1.0f,
+        // +z
+        -1.0f, -1.0f,  1.0f,   1.0f, -1.0f,  1.0f,   1.0f,  1.0f,  1.0f,
+         1.0f,  1.0f,  1.0f,  -1.0f,  1.0f,  1.0f,  -1.0f, -1.0f,  1.0f,
+        // -x
+        -1.0f,  1.0f,  1.0f,  -1.0f,  1.0f, -1.0f,  -1.0f, -1.0f, -1.0f,
+        -1.0f, -1.0f, -1.0f,  -1.0f, -1.0f,  1.0f,  -1.0f,  1.0f,  1.0f,
+        // +x
+         1.0f,  1.0f,  1.0f,   1.0f, -1.0f, -1.0f,   1.0f,  1.0f, -1.0f,
+         1.0f, -1.0f, -1.0f,   1.0f,  1.0f,  1.0f,   1.0f, -1.0f,  1.0f,
+        // -y
+        -1.0f, -1.0f, -1.0f,   1.0f, -1.0f, -1.0f,   1.0f, -1.0f,  1.0f,
+         1.0f, -1.0f,  1.0f,  -1.0f, -1.0f,  1.0f,  -1.0f, -1.0f, -1.0f,
+        // +y
+        -1.0f,  1.0f, -1.0f,   1.0f,  1.0f,  1.0f,   1.0f,  1.0f, -1.0f,
+         1.0f,  1.0f,  1.0f,  -1.0f,  1.0f, -1.0f,  -1.0f,  1.0f,  1.0f
     };
 
-    glGenVertexArrays(1, &quadVAO);
-    glGenBuffers(1, &quadVBO);
-    glBindVertexArray(quadVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+    glGenVertexArrays(1, &cubeVAO);
+    glGenBuffers(1, &cubeVBO);
+    GLStateCache::BindVertexArray(cubeVAO);
+    GLStateCache::BindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), &cubeVertices, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 }
 
 void generateDynamicTextureData(std::vector<unsigned char>& data, int width, int height) {
@@ -218,55 +215,166 @@ void updateDynamicTexture(unsigned int textureID) {
         }
     }
 
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    GLStateCache::BindTexture(GL_TEXTURE_2D, textureID);
     glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texWidth, texHeight,
         GL_RGBA, GL_UNSIGNED_BYTE, textureData.data());
 }
 
 void createRingScreenWithBezier(
-    /*glm::vec3 controlPoints[4][4],*/ 
     int segmentsU, int segmentsV,
     std::vector<float>& vertices,
     std::vector<unsigned int>& indices)
     {
-        vertices.clear();
-        indices.clear();
-
         glm::vec3 controlPoints[4][4];
         GenerateControlPoints4x4(controlPoints);
 
-        for (int i = 0; i <= segmentsU; ++i) {
+        createRingScreenWithBezier(controlPoints, segmentsU, segmentsV, vertices, indices);
+    }
+
+void createRingScreenWithBezier(
+    const glm::vec3 controlPoints[4][4],
+    int segmentsU, int segmentsV,
+    std::vector<float>& vertices,
+    std::vector<unsigned int>& indices,
+    const ArcLengthTable* arcLength)
+    {
+        // sized up front, Float32 rows are written in place
+        vertices.resize(size_t(segmentsU + 1) * (segmentsV + 1) * 8);
+        tessellateRingScreenRows(controlPoints, segmentsU, segmentsV, VertexLayout::Float32,
+            0, segmentsU + 1, reinterpret_cast<unsigned char*>(vertices.data()), arcLength);
+
+        indices.resize(size_t(segmentsU) * segmentsV * 6);
+        writeRingScreenIndices(segmentsU, segmentsV, 0, indices.data());
+    }
+
+void tessellateRingScreenRows(
+    const glm::vec3 controlPoints[4][4],
+    int segmentsU, int segmentsV, VertexLayout layout,
+    int rowBegin, int rowEnd,
+    unsigned char* vertices,
+    const ArcLengthTable* arcLength)
+    {
+        const unsigned int stride = vertexStride(layout);
+        const int rowVerts = segmentsV + 1;
+
+        for (int i = rowBegin; i < rowEnd; ++i) {
+            // u is the texture coordinate, t the bezier parameter of the row
             float u = float(i) / segmentsU;
+            float t = arcLength ? arcLength->Parameter(u) : u;
+
+            // collapse u first: 4 curve points of this row and their u derivatives
+            glm::vec3 q[4], dq[4];
+            for (int c = 0; c < 4; ++c) {
+                q[c] = glm::vec3(0.0f);
+                dq[c] = glm::vec3(0.0f);
+                for (int r = 0; r < 4; ++r) {
+                    q[c] += bernstein(r, t) * controlPoints[r][c];
+                    dq[c] += bernsteinDeriv(r, t) * controlPoints[r][c];
+                }
+            }
+
+            unsigned char* dst = vertices + size_t(i) * rowVerts * stride;
             for (int j = 0; j <= segmentsV; ++j) {
                 float v = float(j) / segmentsV;
 
-                glm::vec3 pos = bezierSurfacePoint(controlPoints, u, v);
-                glm::vec3 du = bezierSurfaceTangentU(controlPoints, u, v);
-                glm::vec3 dv = bezierSurfaceTangentV(controlPoints, u, v);
+                glm::vec3 pos(0.0f), du(0.0f), dv(0.0f);
+                for (int c = 0; c < 4; ++c) {
+                    pos += bernstein(c, v) * q[c];
+                    du += bernstein(c, v) * dq[c];
+                    dv += bernsteinDeriv(c, v) * q[c];
+                }
                 glm::vec3 normal = glm::normalize(glm::cross(du, dv));
 
-                vertices.push_back(pos.x);
-                vertices.push_back(pos.y);
-                vertices.push_back(pos.z);
-                vertices.push_back(normal.x);
-                vertices.push_back(normal.y);
-                vertices.push_back(normal.z);
-                vertices.push_back(u);
-                vertices.push_back(v);
+                float vertex[8] = { pos.x, pos.y, pos.z, normal.x, normal.y, normal.z, u, v };
+                packVertices(vertex, 1, layout, dst + size_t(j) * stride);
             }
         }
+    }
+
+void writeRingScreenIndices(int segmentsU, int segmentsV, int bandWidth, unsigned int* indices)
+{
+    writeGridIndices(segmentsU, segmentsV, bandWidth, indices);
+}
+
+void writeRingScreenIndices(int segmentsU, int segmentsV, int bandWidth, unsigned short* indices)
+{
+    writeGridIndices(segmentsU, segmentsV, bandWidth, indices);
+}
+
+bool createRingScreenMapped(
+    const glm::vec3 controlPoints[4][4],
+    int segmentsU, int segmentsV,
+    SceneBatch& batch, int draw,
+    const ArcLengthTable* arcLength)
+    {
+        unsigned char* vertices = nullptr;
+        void* indices = nullptr;
+        if (draw < 0 || !batch.Map(draw, vertices, indices))
+            return false;
+
+        // workers only write the mapped memory, all GL calls stay on this thread
+        const VertexLayout layout = batch.GetLayout();
+        const int rows = segmentsU + 1;
+        int threadCount = std::max(1, std::min(int(std::thread::hardware_concurrency()), rows / 16));
+        std::vector<std::thread> workers;
+        for (int t = 1; t < threadCount; ++t) {
+            workers.emplace_back([=]() {
+                tessellateRingScreenRows(controlPoints, segmentsU, segmentsV, layout,
+                    rows * t / threadCount, rows * (t + 1) / threadCount, vertices, arcLength);
+            });
+        }
+
+        // column bands keep the post-transform cache warm without a reorder pass
+        if (batch.GetIndexType() == GL_UNSIGNED_SHORT)
+            writeRingScreenIndices(segmentsU, segmentsV, kRingScreenIndexBand, static_cast<unsigned short*>(indices));
+        else
+            writeRingScreenIndices(segmentsU, segmentsV, kRingScreenIndexBand, static_cast<unsigned int*>(indices));
+
+        tessellateRingScreenRows(controlPoints, segmentsU, segmentsV, layout, 0, rows / threadCount, vertices, arcLength);
+        for (std::thread& worker : workers)
+            worker.join();
+
+        batch.Unmap();
+        return true;
+    }
 
-        int rowVerts = segmentsV + 1;
-        for (int i = 0; i < segmentsU; ++i) {
-            for (int j = 0; j < segmentsV; ++j) {
-                int idx = i * rowVerts + j;
-                indices.push_back(idx);
-                indices.push_back(idx + rowVerts);
-                indices.push_back(idx + rowVerts + 1);
-
-                indices.push_back(idx);
-                indices.push_back(idx + rowVerts + 1);
-                indices.push_back(idx + 1);
+void createRingScreenUVGrid(
+    int segmentsU, int segmentsV,
+    std::vector<unsigned short>& uvs,
+    std::vector<unsigned int>& indices)
+    {
+        uvs.clear();
+        uvs.reserve(size_t(segmentsU + 1) * (segmentsV + 1) * 2);
+
+        // same vertex order and topology as createRingScreenWithBezier
+        for (int i = 0; i <= segmentsU; ++i) {
+            for (int j = 0; j <= segmentsV; ++j) {
+                uvs.push_back(static_cast<unsigned short>(65535 * i / segmentsU));
+                uvs.push_back(static_cast<unsigned short>(65535 * j / segmentsV));
             }
         }
-    }
\ No newline at end of file
+
+        indices.resize(size_t(segmentsU) * segmentsV * 6);
+        writeRingScreenIndices(segmentsU, segmentsV, 0, indices.data());
+    }
+
+void buildRingScreenMesh(const MeshCacheKey& key, MeshBlobs& mesh)
+{
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    ArcLengthTable arcLength;
+    if (key.flags & kMeshFlagArcLengthUV)
+        arcLength.Build(key.controlPoints);
+    createRingScreenWithBezier(key.controlPoints, key.segmentsU, key.segmentsV, vertices, indices,
+        arcLength.IsBuilt() ? &arcLength : nullptr);
+
+    mesh.vertexCount = vertices.size() / 8;
+    mesh.indexCount = indices.size();
+    if (key.flags & kMeshFlagOptimizeVertexCache)
+        optimizeVertexCache(indices, mesh.vertexCount);
+    if (key.flags & kMeshFlagOptimizeVertexFetch)
+        optimizeVertexFetch(vertices, 8, indices);
+
+    packVertices(vertices, key.layout, mesh.vertices);
+    mesh.indexType = packIndices(indices, mesh.vertexCount, mesh.indices);
+}
@@ -0,0 +1,71 @@
+#include "utils/LensLut.h"
+#include "utils/GLStateCache.h"
+#include <glad/glad.h>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace {
+    const int kChannelCount = 3;
+    const int kEyeCount = 2;
+    // stored for panel positions without a solution, the scene lookup lands outside [0, 1]
+    const float kUnsolvedOffset = 4.0f;
+}
+
+void LensLut::Build(const LensProfile& profile, int size)
+{
+    const int layerCount = kEyeCount * kChannelCount;
+    std::vector<unsigned short> texels(size_t(size) * size * layerCount * 2);
+    mMaxRoundTripError = 0.0f;
+    mUnsolvedCount = 0;
+
+    for (int eye = 0; eye < kEyeCount; ++eye) {
+        const glm::vec2 center = lensCenter(profile, eye);
+        for (int channel = 0; channel < kChannelCount; ++channel) {
+            unsigned short* layer = texels.data() + size_t(eye * kChannelCount + channel) * size * size * 2;
+            for (int y = 0; y < size; ++y) {
+                for (int x = 0; x < size; ++x) {
+                    unsigned short* texel = layer + (size_t(y) * size + x) * 2;
+                    // texel centers, where linear filtering returns the texel as is
+                    glm::vec2 position((x + 0.5f) / size, (y + 0.5f) / size);
+                    glm::vec2 scene;
+                    if (!lensSceneCoordinates(profile, eye, channel, position, scene)) {
+                        texel[0] = texel[1] = glm::packHalf1x16(kUnsolvedOffset);
+                        ++mUnsolvedCount;
+                        continue;
+                    }
+                    glm::vec2 offset = scene - position;
+                    texel[0] = glm::packHalf1x16(offset.x);
+                    texel[1] = glm::packHalf1x16(offset.y);
+
+                    // what the shader will read, forward through the lens again
+                    glm::vec2 stored = position + glm::vec2(glm::unpackHalf1x16(texel[0]), glm::unpackHalf1x16(texel[1]));
+                    glm::vec2 view = stored * 2.0f - 1.0f - center;
+                    float radius = glm::length(view);
+                    glm::vec2 panel = center + (radius > 0.0f ? view * (lensPanelRadius(profile, channel, radius) / radius) : view);
+                    mMaxRoundTripError = std::max(mMaxRoundTripError, glm::length(panel * 0.5f + 0.5f - position));
+                }
+            }
+        }
+    }
+
+    // immutable storage, a new size needs a new texture
+    if (!mTexture || mSize != size) {
+        mTexture = GLTexture::Create();
+        mSize = size;
+        GLStateCache::BindTexture(GL_TEXTURE_2D_ARRAY, mTexture.Get());
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RG16F, size, size, layerCount);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    GLStateCache::BindTexture(GL_TEXTURE_2D_ARRAY, mTexture.Get());
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, size, size, layerCount, GL_RG, GL_HALF_FLOAT, texels.data());
+}
+
+void LensLut::Release()
+{
+    mTexture.Reset();
+    mSize = 0;
+}
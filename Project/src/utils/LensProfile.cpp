@@ -0,0 +1,95 @@
+#include "utils/LensProfile.h"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+LensProfile defaultLensProfile()
+{
+    LensProfile profile;
+    profile.name = "default";
+    profile.k1 = -0.10f;
+    profile.k2 = 0.02f;
+    profile.channelScale = glm::vec3(0.995f, 1.0f, 1.005f);
+    profile.centerOffset = 0.05f;
+    return profile;
+}
+
+bool loadLensProfiles(const std::string& path, std::vector<LensProfile>& profiles)
+{
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot open lens profiles " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream tokens(line);
+        LensProfile profile;
+        if (!(tokens >> profile.name))
+            continue;
+
+        glm::vec3& scale = profile.channelScale;
+        bool ok = static_cast<bool>(tokens >> profile.k1 >> profile.k2 >> profile.k3 >> scale.r >> scale.g >> scale.b);
+        if (ok && !(tokens >> profile.centerOffset))
+            profile.centerOffset = 0.0f;
+        if (!ok || scale.r <= 0.0f || scale.g <= 0.0f || scale.b <= 0.0f) {
+            std::cerr << path << ":" << lineNumber << ": expected \"name k1 k2 k3 scaleRed scaleGreen scaleBlue [centerOffset]\"" << std::endl;
+            return false;
+        }
+        profiles.push_back(profile);
+    }
+    return true;
+}
+
+glm::vec2 lensCenter(const LensProfile& profile, int eye)
+{
+    return glm::vec2(eye == 1 ? -profile.centerOffset : profile.centerOffset, 0.0f);
+}
+
+float lensPanelRadius(const LensProfile& profile, int channel, float radius)
+{
+    float r2 = radius * radius;
+    return profile.channelScale[channel] * radius * (1.0f + r2 * (profile.k1 + r2 * (profile.k2 + r2 * profile.k3)));
+}
+
+bool lensViewRadius(const LensProfile& profile, int channel, float panelRadius, float& radius)
+{
+    const float scale = profile.channelScale[channel];
+    // the lens is close to linear, start from the scale alone
+    double r = panelRadius / scale;
+    for (int iteration = 0; iteration < 16; ++iteration) {
+        double r2 = r * r;
+        double value = scale * r * (1.0 + r2 * (profile.k1 + r2 * (profile.k2 + r2 * profile.k3))) - panelRadius;
+        double slope = scale * (1.0 + r2 * (3.0 * profile.k1 + r2 * (5.0 * profile.k2 + r2 * 7.0 * profile.k3)));
+        // past the fold the panel radius shrinks again, that part of the view never reaches the panel
+        if (slope <= 0.0)
+            return false;
+        double step = value / slope;
+        r -= step;
+        if (r < 0.0)
+            return false;
+        if (std::abs(step) < 1e-7) {
+            radius = static_cast<float>(r);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool lensSceneCoordinates(const LensProfile& profile, int eye, int channel, glm::vec2 position, glm::vec2& scene)
+{
+    glm::vec2 center = lensCenter(profile, eye);
+    glm::vec2 offset = position * 2.0f - 1.0f - center;
+    float panelRadius = glm::length(offset);
+    float radius = 0.0f;
+    if (panelRadius > 0.0f && !lensViewRadius(profile, channel, panelRadius, radius))
+        return false;
+
+    // radial: the view keeps the panel position's direction from the lens center
+    glm::vec2 view = panelRadius > 0.0f ? center + offset * (radius / panelRadius) : center;
+    scene = view * 0.5f + 0.5f;
+    return true;
+}
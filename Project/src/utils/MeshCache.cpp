@@ -0,0 +1,259 @@
+#include "utils/MeshCache.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+    const char kMeshCacheMagic[4] = { 'V', 'R', 'M', 'C' };
+
+    template <typename T>
+    uint64_t hashValue(const T& value, uint64_t hash)
+    {
+        return fnv1a64(&value, sizeof(T), hash);
+    }
+
+    void makeDirectory(const std::string& directory)
+    {
+#ifdef _WIN32
+        _mkdir(directory.c_str());
+#else
+        mkdir(directory.c_str(), 0755);
+#endif
+    }
+}
+
+uint64_t fnv1a64(const void* data, size_t bytes, uint64_t hash)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < bytes; ++i) {
+        hash ^= p[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t MeshCacheKey::Hash() const
+{
+    // field by field, struct padding must not leak into the key
+    uint64_t hash = hashValue(kMeshCacheVersion, 14695981039346656037ull);
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            hash = fnv1a64(&controlPoints[i][j][0], 3 * sizeof(float), hash);
+    hash = hashValue(degree, hash);
+    hash = hashValue(segmentsU, hash);
+    hash = hashValue(segmentsV, hash);
+    hash = hashValue(static_cast<uint32_t>(layout), hash);
+    hash = hashValue(flags, hash);
+    return hash;
+}
+
+std::string meshCachePath(const std::string& directory, const std::string& name, const MeshCacheKey& key)
+{
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(key.Hash()));
+    return directory + "/" + name + "_" + hex + ".meshcache";
+}
+
+MeshBlobView MeshBlobs::View() const
+{
+    MeshBlobView view;
+    view.vertexData = vertices.data();
+    view.vertexBytes = vertices.size();
+    view.vertexCount = vertexCount;
+    view.indexData = indices.data();
+    view.indexBytes = indices.size();
+    view.indexCount = indexCount;
+    view.indexType = indexType;
+    return view;
+}
+
+bool writeMeshCache(const std::string& path, const MeshCacheKey& key, const MeshBlobView& mesh)
+{
+    size_t slash = path.find_last_of("/\\");
+    if (slash != std::string::npos)
+        makeDirectory(path.substr(0, slash));
+
+    MeshCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMeshCacheMagic, sizeof(header.magic));
+    header.version = kMeshCacheVersion;
+    header.keyHash = key.Hash();
+    header.contentHash = fnv1a64(mesh.indexData, mesh.indexBytes, fnv1a64(mesh.vertexData, mesh.vertexBytes));
+    header.layout = static_cast<uint32_t>(key.layout);
+    header.indexType = mesh.indexType;
+    header.vertexCount = static_cast<uint32_t>(mesh.vertexCount);
+    header.indexCount = static_cast<uint32_t>(mesh.indexCount);
+    header.vertexBytes = mesh.vertexBytes;
+    header.indexBytes = mesh.indexBytes;
+
+    // write to a temporary file first so a crash never leaves a half-written cache
+    std::string tmpPath = path + ".tmp";
+    FILE* file = std::fopen(tmpPath.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Mesh cache: can't write " << tmpPath << std::endl;
+        return false;
+    }
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+        && std::fwrite(mesh.vertexData, 1, mesh.vertexBytes, file) == mesh.vertexBytes
+        && std::fwrite(mesh.indexData, 1, mesh.indexBytes, file) == mesh.indexBytes;
+    ok = (std::fclose(file) == 0) && ok;
+
+    std::remove(path.c_str());
+    if (!ok || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        std::cerr << "Mesh cache: failed writing " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+MeshCacheFile::~MeshCacheFile()
+{
+    Close();
+}
+
+bool MeshCacheFile::Open(const std::string& path, const MeshCacheKey& key)
+{
+    Close();
+    if (!map(path))
+        return false;
+
+    const char* reason = nullptr;
+    mHeader = reinterpret_cast<const MeshCacheHeader*>(mData);
+    if (mSize < sizeof(MeshCacheHeader) || std::memcmp(mHeader->magic, kMeshCacheMagic, 4) != 0)
+        reason = "bad magic";
+    else if (mHeader->version != kMeshCacheVersion)
+        reason = "version mismatch";
+    else if (mHeader->keyHash != key.Hash())
+        reason = "key mismatch";
+    else if (mSize != sizeof(MeshCacheHeader) + mHeader->vertexBytes + mHeader->indexBytes)
+        reason = "truncated";
+    else if (fnv1a64(IndexData(), mHeader->indexBytes, fnv1a64(VertexData(), mHeader->vertexBytes)) != mHeader->contentHash)
+        reason = "content hash mismatch";
+
+    if (reason) {
+        std::cerr << "Mesh cache: stale " << path << " (" << reason << ")" << std::endl;
+        Close();
+        return false;
+    }
+    return true;
+}
+
+const void* MeshCacheFile::VertexData() const noexcept
+{
+    return mData + sizeof(MeshCacheHeader);
+}
+
+const void* MeshCacheFile::IndexData() const noexcept
+{
+    return mData + sizeof(MeshCacheHeader) + mHeader->vertexBytes;
+}
+
+MeshBlobView MeshCacheFile::View() const
+{
+    MeshBlobView view;
+    view.vertexData = VertexData();
+    view.vertexBytes = static_cast<size_t>(mHeader->vertexBytes);
+    view.vertexCount = mHeader->vertexCount;
+    view.indexData = IndexData();
+    view.indexBytes = static_cast<size_t>(mHeader->indexBytes);
+    view.indexCount = mHeader->indexCount;
+    view.indexType = mHeader->indexType;
+    return view;
+}
+
+#ifdef _WIN32
+
+bool MeshCacheFile::map(const std::string& path)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!view) {
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    mFile = file;
+    mMapping = mapping;
+    mData = static_cast<const unsigned char*>(view);
+    mSize = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+void MeshCacheFile::Close()
+{
+    if (mData)
+        UnmapViewOfFile(mData);
+    if (mMapping)
+        CloseHandle(mMapping);
+    if (mFile)
+        CloseHandle(mFile);
+    mData = nullptr;
+    mMapping = nullptr;
+    mFile = nullptr;
+    mHeader = nullptr;
+    mSize = 0;
+}
+
+#else
+
+bool MeshCacheFile::map(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+    if (view == MAP_FAILED)
+        return false;
+
+    mData = static_cast<const unsigned char*>(view);
+    mSize = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+void MeshCacheFile::Close()
+{
+    if (mData)
+        munmap(const_cast<unsigned char*>(mData), mSize);
+    mData = nullptr;
+    mHeader = nullptr;
+    mSize = 0;
+}
+
+#endif
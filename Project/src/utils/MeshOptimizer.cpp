@@ -0,0 +1,245 @@
+#include "utils/MeshOptimizer.h"
+#include "utils/Helper.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+
+namespace {
+
+    // Forsyth scoring parameters
+    const int kCacheSize = 32;
+    const float kCacheDecayPower = 1.5f;
+    const float kLastTriScore = 0.75f;
+    const float kValenceBoostScale = 2.0f;
+    const float kValenceBoostPower = 0.5f;
+
+    float vertexScore(int cachePosition, int activeTriangles)
+    {
+        if (activeTriangles == 0)
+            return -1.0f; // no triangle left, never pick it
+
+        float score = 0.0f;
+        if (cachePosition >= 0) {
+            if (cachePosition < 3) {
+                // used by the last triangle, fixed score so it is not favoured too much
+                score = kLastTriScore;
+            }
+            else {
+                float scaler = 1.0f / (kCacheSize - 3);
+                score = std::pow(1.0f - (cachePosition - 3) * scaler, kCacheDecayPower);
+            }
+        }
+
+        // bonus for vertices with few remaining triangles, clears out lone ones
+        score += kValenceBoostScale * std::pow(float(activeTriangles), -kValenceBoostPower);
+        return score;
+    }
+}
+
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+    const size_t triCount = indices.size() / 3;
+    if (triCount == 0)
+        return;
+
+    // vertex -> triangle adjacency
+    std::vector<int> activeTris(vertexCount, 0);
+    for (unsigned int idx : indices)
+        activeTris[idx]++;
+
+    std::vector<int> adjOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+        adjOffset[v + 1] = adjOffset[v] + activeTris[v];
+
+    std::vector<int> adjTris(indices.size());
+    std::vector<int> fill(adjOffset.begin(), adjOffset.end() - 1);
+    for (size_t t = 0; t < triCount; ++t)
+        for (int k = 0; k < 3; ++k)
+            adjTris[fill[indices[t * 3 + k]]++] = int(t);
+
+    std::vector<float> vScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        vScore[v] = vertexScore(-1, activeTris[v]);
+
+    std::vector<float> tScore(triCount);
+    std::vector<char> emitted(triCount, 0);
+    for (size_t t = 0; t < triCount; ++t)
+        tScore[t] = vScore[indices[t * 3]] + vScore[indices[t * 3 + 1]] + vScore[indices[t * 3 + 2]];
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+
+    std::vector<unsigned int> cache;
+    cache.reserve(kCacheSize + 3);
+
+    size_t scanCursor = 0;
+    int bestTri = 0;
+    for (size_t t = 1; t < triCount; ++t)
+        if (tScore[t] > tScore[bestTri])
+            bestTri = int(t);
+
+    while (bestTri >= 0) {
+        emitted[bestTri] = 1;
+
+        // emit and push the triangle's vertices to the front of the LRU cache
+        std::vector<unsigned int> newCache;
+        newCache.reserve(kCacheSize + 3);
+        for (int k = 0; k < 3; ++k) {
+            unsigned int v = indices[bestTri * 3 + k];
+            result.push_back(v);
+            newCache.push_back(v);
+
+            // remove the triangle from the vertex's active list
+            int begin = adjOffset[v];
+            int end = begin + activeTris[v];
+            for (int a = begin; a < end; ++a) {
+                if (adjTris[a] == bestTri) {
+                    std::swap(adjTris[a], adjTris[end - 1]);
+                    break;
+                }
+            }
+            activeTris[v]--;
+        }
+        for (unsigned int v : cache)
+            if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+                newCache.push_back(v);
+
+        // vertices falling out of the cache lose their position score
+        for (size_t c = kCacheSize; c < newCache.size(); ++c)
+            vScore[newCache[c]] = vertexScore(-1, activeTris[newCache[c]]);
+        if (newCache.size() > size_t(kCacheSize))
+            newCache.resize(kCacheSize);
+        cache.swap(newCache);
+
+        for (size_t c = 0; c < cache.size(); ++c)
+            vScore[cache[c]] = vertexScore(int(c), activeTris[cache[c]]);
+
+        // rescore the triangles touching the cache and pick the best of them
+        bestTri = -1;
+        float bestScore = -1.0f;
+        for (unsigned int v : cache) {
+            for (int a = adjOffset[v]; a < adjOffset[v] + activeTris[v]; ++a) {
+                int t = adjTris[a];
+                tScore[t] = vScore[indices[t * 3]] + vScore[indices[t * 3 + 1]] + vScore[indices[t * 3 + 2]];
+                if (tScore[t] > bestScore) {
+                    bestScore = tScore[t];
+                    bestTri = t;
+                }
+            }
+        }
+
+        // nothing adjacent to the cache, continue with the next unemitted triangle
+        if (bestTri < 0) {
+            while (scanCursor < triCount && emitted[scanCursor])
+                scanCursor++;
+            if (scanCursor < triCount)
+                bestTri = int(scanCursor);
+        }
+    }
+
+    indices.swap(result);
+}
+
+void optimizeVertexFetch(std::vector<float>& vertices, size_t floatsPerVertex, std::vector<unsigned int>& indices)
+{
+    const size_t vertexCount = vertices.size() / floatsPerVertex;
+    std::vector<unsigned int> remap(vertexCount, ~0u);
+    std::vector<float> result(vertices.size());
+
+    unsigned int next = 0;
+    for (unsigned int& idx : indices) {
+        if (remap[idx] == ~0u) {
+            remap[idx] = next;
+            std::copy(vertices.begin() + idx * floatsPerVertex,
+                vertices.begin() + (idx + 1) * floatsPerVertex,
+                result.begin() + next * floatsPerVertex);
+            next++;
+        }
+        idx = remap[idx];
+    }
+
+    // keep unreferenced vertices at the end
+    for (size_t v = 0; v < vertexCount; ++v) {
+        if (remap[v] == ~0u) {
+            std::copy(vertices.begin() + v * floatsPerVertex,
+                vertices.begin() + (v + 1) * floatsPerVertex,
+                result.begin() + next * floatsPerVertex);
+            next++;
+        }
+    }
+
+    vertices.swap(result);
+}
+
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize)
+{
+    VertexCacheStats stats;
+    if (indices.empty() || vertexCount == 0)
+        return stats;
+
+    // FIFO cache, timestamps of when each vertex entered it
+    std::vector<size_t> entered(vertexCount, 0);
+    size_t clock = cacheSize + 1;
+    size_t misses = 0;
+    for (unsigned int idx : indices) {
+        if (clock - entered[idx] > size_t(cacheSize)) {
+            entered[idx] = clock++;
+            misses++;
+        }
+    }
+
+    stats.acmr = float(misses) / float(indices.size() / 3);
+    stats.atvr = float(misses) / float(vertexCount);
+    return stats;
+}
+
+unsigned int packIndices(const std::vector<unsigned int>& indices, size_t vertexCount, std::vector<unsigned char>& dst)
+{
+    if (vertexCount <= 0xFFFF) {
+        dst.resize(indices.size() * sizeof(unsigned short));
+        unsigned short* shortIndices = reinterpret_cast<unsigned short*>(dst.data());
+        for (size_t i = 0; i < indices.size(); ++i)
+            shortIndices[i] = static_cast<unsigned short>(indices[i]);
+        return GL_UNSIGNED_SHORT;
+    }
+
+    dst.resize(indices.size() * sizeof(unsigned int));
+    std::memcpy(dst.data(), indices.data(), dst.size());
+    return GL_UNSIGNED_INT;
+}
+
+unsigned int uploadIndexBuffer(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int usage)
+{
+    std::vector<unsigned char> data;
+    unsigned int indexType = packIndices(indices, vertexCount, data);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.size(), data.data(), usage);
+    return indexType;
+}
+
+void printRingScreenCacheReport(const std::vector<int>& segmentCounts)
+{
+    std::streamsize oldPrecision = std::cout.precision();
+    std::cout << "Ring screen vertex cache (FIFO 16): segments | ACMR before -> after | ATVR before -> after" << std::endl;
+
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    for (int segments : segmentCounts) {
+        createRingScreenWithBezier(segments, segments, vertices, indices);
+        size_t vertexCount = vertices.size() / 8;
+
+        VertexCacheStats before = analyzeVertexCache(indices, vertexCount);
+        optimizeVertexCache(indices, vertexCount);
+        VertexCacheStats after = analyzeVertexCache(indices, vertexCount);
+
+        std::cout << std::fixed << std::setprecision(3)
+            << "  " << std::setw(4) << segments << " x " << std::setw(4) << segments
+            << " | " << before.acmr << " -> " << after.acmr
+            << " | " << before.atvr << " -> " << after.atvr
+            << (vertexCount <= 0xFFFF ? "  (16-bit indices)" : "  (32-bit indices)") << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout.precision(oldPrecision);
+}
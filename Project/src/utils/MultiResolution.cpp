@@ -0,0 +1,88 @@
+#include "utils/MultiResolution.h"
+#include <algorithm>
+#include <cmath>
+
+void MultiResLayout::Build(int width, int height, float foveaSize, float peripheryDensity)
+{
+    foveaSize = glm::clamp(foveaSize, 0.0f, 1.0f);
+    peripheryDensity = glm::clamp(peripheryDensity, 0.0f, 1.0f);
+    const int size[2] = { width, height };
+    for (int axis = 0; axis < 2; ++axis) {
+        mFullSize[axis] = size[axis];
+        mViewEdge[axis] = 0.5f * (1.0f - foveaSize);
+        mCenter[axis] = std::max(1, static_cast<int>(std::lround(size[axis] * foveaSize)));
+        // an outer cell keeps a pixel as long as it covers any of the view
+        mOuter[axis] = foveaSize < 1.0f
+            ? std::max(1, static_cast<int>(std::lround(size[axis] * mViewEdge[axis] * peripheryDensity))) : 0;
+    }
+}
+
+float MultiResLayout::GetShadedFraction() const noexcept
+{
+    if (mFullSize[0] <= 0 || mFullSize[1] <= 0)
+        return 1.0f;
+    return float(GetWidth()) * float(GetHeight()) / (float(mFullSize[0]) * float(mFullSize[1]));
+}
+
+void MultiResLayout::GetCell(int column, int row, glm::vec4& viewport, glm::ivec4& scissor) const
+{
+    const int cell[2] = { column, row };
+    for (int axis = 0; axis < 2; ++axis) {
+        float viewBegin, viewEnd;
+        int pixelBegin, pixels;
+        getCellSpan(axis, cell[axis], viewBegin, viewEnd, pixelBegin, pixels);
+
+        // the viewport spans the whole view at the cell's density, shifted so the cell lands on its pixels
+        const float density = viewEnd > viewBegin ? pixels / (viewEnd - viewBegin) : 0.0f;
+        viewport[axis] = pixelBegin - viewBegin * density;
+        viewport[axis + 2] = density;
+        scissor[axis] = pixelBegin;
+        scissor[axis + 2] = pixels;
+    }
+}
+
+glm::mat4 MultiResLayout::GetCellCrop(int column, int row) const
+{
+    const int cell[2] = { column, row };
+    glm::mat4 crop(1.0f);
+    for (int axis = 0; axis < 2; ++axis) {
+        float viewBegin, viewEnd;
+        int pixelBegin, pixels;
+        getCellSpan(axis, cell[axis], viewBegin, viewEnd, pixelBegin, pixels);
+        // [2 begin - 1, 2 end - 1] of normalized device coordinates onto [-1, 1]
+        const float halfSize = std::max(viewEnd - viewBegin, 1e-6f);
+        crop[axis][axis] = 1.0f / halfSize;
+        crop[3][axis] = (1.0f - viewBegin - viewEnd) / halfSize;
+    }
+    return crop;
+}
+
+glm::vec4 MultiResLayout::GetViewEdges() const noexcept
+{
+    return glm::vec4(mViewEdge[0], mViewEdge[1], 1.0f - mViewEdge[0], 1.0f - mViewEdge[1]);
+}
+
+void MultiResLayout::GetTargetMapping(glm::vec4& middle, glm::vec4& slopes) const
+{
+    const int size[2] = { std::max(1, GetWidth()), std::max(1, GetHeight()) };
+    for (int axis = 0; axis < 2; ++axis) {
+        const float view0 = mViewEdge[axis], view1 = 1.0f - mViewEdge[axis];
+        const float target0 = float(mOuter[axis]) / size[axis];
+        const float target1 = float(mOuter[axis] + mCenter[axis]) / size[axis];
+        const float middleSlope = view1 > view0 ? (target1 - target0) / (view1 - view0) : 0.0f;
+        middle[axis] = middleSlope;
+        middle[axis + 2] = target0 - view0 * middleSlope;
+        // no outer cells (fovea of the whole view): nothing to bend
+        slopes[axis] = view0 > 0.0f ? target0 / view0 - middleSlope : 0.0f;
+        slopes[axis + 2] = view0 > 0.0f ? (1.0f - target1) / view0 - middleSlope : 0.0f;
+    }
+}
+
+void MultiResLayout::getCellSpan(int axis, int index, float& viewBegin, float& viewEnd, int& pixelBegin, int& pixels) const
+{
+    const float edge = mViewEdge[axis];
+    viewBegin = index == 0 ? 0.0f : index == 1 ? edge : 1.0f - edge;
+    viewEnd = index == 0 ? edge : index == 1 ? 1.0f - edge : 1.0f;
+    pixelBegin = index == 0 ? 0 : index == 1 ? mOuter[axis] : mOuter[axis] + mCenter[axis];
+    pixels = index == 1 ? mCenter[axis] : mOuter[axis];
+}
@@ -0,0 +1,385 @@
+#include "utils/RenderGraph.h"
+#include "utils/GLStateCache.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+const int RenderGraph::kBackbuffer;
+
+namespace {
+    // GL_OVR_multiview
+    typedef void (APIENTRYP FramebufferTextureMultiviewProc)(GLenum target, GLenum attachment, GLuint texture,
+        GLint level, GLint baseViewIndex, GLsizei numViews);
+}
+
+void RenderGraph::BeginFrame(int width, int height)
+{
+    mAttachments.clear();
+    mPasses.clear();
+    mOutputWidth = width;
+    mOutputHeight = height;
+}
+
+int RenderGraph::CreateAttachment(const std::string& name, const AttachmentDesc& desc)
+{
+    Attachment attachment;
+    attachment.name = name;
+    attachment.desc = desc;
+    mAttachments.push_back(attachment);
+    return static_cast<int>(mAttachments.size()) - 1;
+}
+
+int RenderGraph::AddPass(const RenderPassDesc& desc)
+{
+    mPasses.push_back(desc);
+    return static_cast<int>(mPasses.size()) - 1;
+}
+
+void RenderGraph::Export(int attachment)
+{
+    mAttachments[attachment].exported = true;
+}
+
+void RenderGraph::Execute()
+{
+    // minimized window, nothing to draw into
+    if (mOutputWidth <= 0 || mOutputHeight <= 0)
+        return;
+
+    std::string key = declarationKey();
+    if (key != mCompiledKey) {
+        compile();
+        mCompiledKey = key;
+    }
+
+    for (size_t p = 0; p < mPasses.size(); ++p) {
+        const PassState& state = mPassStates[p];
+        if (!state.live)
+            continue;
+        GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, state.backbuffer ? mBackbuffer : state.framebuffer.Get());
+        glViewport(0, 0, state.width, state.height);
+        mRunningPass = static_cast<int>(p);
+        if (mPasses[p].execute)
+            mPasses[p].execute(*this);
+        if (mLayerSelected)
+            SelectLayer(-1);
+        mRunningPass = -1;
+    }
+}
+
+unsigned int RenderGraph::GetTexture(int attachment) const
+{
+    int texture = mAttachmentStates[attachment].texture;
+    return texture < 0 ? 0 : mPool[texture].texture.Get();
+}
+
+unsigned int RenderGraph::GetTextureTarget(int attachment) const
+{
+    const AttachmentDesc& desc = mAttachments[attachment].desc;
+    if (desc.layers > 0)
+        return desc.samples > 1 ? GL_TEXTURE_2D_MULTISAMPLE_ARRAY : GL_TEXTURE_2D_ARRAY;
+    return desc.samples > 1 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+}
+
+void RenderGraph::SelectLayer(int layer) const
+{
+    if (mRunningPass < 0 || mPassStates[mRunningPass].backbuffer)
+        return;
+    const RenderPassDesc& pass = mPasses[mRunningPass];
+    for (size_t i = 0; i < pass.colorOutputs.size(); ++i)
+        attach(GL_COLOR_ATTACHMENT0 + static_cast<unsigned int>(i), pass.colorOutputs[i], pass, layer);
+    if (pass.depthOutput >= 0) {
+        unsigned int format = mAttachments[pass.depthOutput].desc.format;
+        unsigned int point = format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8
+            ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        attach(point, pass.depthOutput, pass, layer);
+    }
+    mLayerSelected = layer >= 0;
+}
+
+void RenderGraph::GetAttachmentSize(int attachment, int& width, int& height) const
+{
+    width = mAttachmentStates[attachment].width;
+    height = mAttachmentStates[attachment].height;
+}
+
+int RenderGraph::GetLivePassCount() const noexcept
+{
+    int count = 0;
+    for (const PassState& state : mPassStates)
+        if (state.live)
+            ++count;
+    return count;
+}
+
+void RenderGraph::PrintSummary() const
+{
+    std::cout << "Render graph at " << mOutputWidth << "x" << mOutputHeight << ": "
+        << GetLivePassCount() << "/" << mPasses.size() << " passes live, "
+        << mAttachments.size() << " attachments in " << mPool.size() << " textures" << std::endl;
+    for (size_t p = 0; p < mPasses.size() && p < mPassStates.size(); ++p)
+        std::cout << "  pass " << mPasses[p].name << (mPassStates[p].live ? "" : " (culled)") << std::endl;
+    for (size_t a = 0; a < mAttachments.size() && a < mAttachmentStates.size(); ++a) {
+        const AttachmentState& state = mAttachmentStates[a];
+        std::cout << "  " << mAttachments[a].name << " " << state.width << "x" << state.height;
+        if (mAttachments[a].desc.layers > 0)
+            std::cout << "x" << mAttachments[a].desc.layers << " layers";
+        if (mAttachments[a].desc.samples > 1)
+            std::cout << " " << mAttachments[a].desc.samples << "x MSAA";
+        if (state.texture < 0)
+            std::cout << " (unused)" << std::endl;
+        else
+            std::cout << " -> texture " << state.texture << ", passes " << state.firstUse
+                << ".." << state.lastUse << std::endl;
+    }
+}
+
+void RenderGraph::Release()
+{
+    mPassStates.clear();
+    mAttachmentStates.clear();
+    mPool.clear();
+    mCompiledKey.clear();
+}
+
+std::string RenderGraph::declarationKey() const
+{
+    std::ostringstream key;
+    key << mOutputWidth << "x" << mOutputHeight;
+    for (const Attachment& attachment : mAttachments) {
+        const AttachmentDesc& desc = attachment.desc;
+        key << "|a" << desc.format << "," << desc.scale << "," << desc.width << "," << desc.height
+            << "," << desc.samples << "," << desc.layers << "," << attachment.exported;
+    }
+    for (const RenderPassDesc& pass : mPasses) {
+        key << "|p";
+        for (int input : pass.inputs)
+            key << "i" << input;
+        for (int output : pass.colorOutputs)
+            key << "o" << output;
+        key << "d" << pass.depthOutput << "v" << pass.viewCount;
+    }
+    return key.str();
+}
+
+void RenderGraph::compile()
+{
+    mAttachmentStates.assign(mAttachments.size(), AttachmentState());
+    mPassStates.resize(mPasses.size());
+
+    for (size_t a = 0; a < mAttachments.size(); ++a) {
+        const AttachmentDesc& desc = mAttachments[a].desc;
+        AttachmentState& state = mAttachmentStates[a];
+        if (desc.width > 0 && desc.height > 0) {
+            state.width = desc.width;
+            state.height = desc.height;
+        }
+        else {
+            state.width = std::max(1, static_cast<int>(mOutputWidth * desc.scale + 0.5f));
+            state.height = std::max(1, static_cast<int>(mOutputHeight * desc.scale + 0.5f));
+        }
+    }
+
+    cullPasses();
+    assignTextures();
+    buildFramebuffers();
+    ++mCompiles;
+}
+
+void RenderGraph::cullPasses()
+{
+    // walk back from the back buffer and the exports, writers come before their readers
+    std::vector<bool> needed(mAttachments.size(), false);
+    for (size_t a = 0; a < mAttachments.size(); ++a)
+        needed[a] = mAttachments[a].exported;
+
+    for (int p = static_cast<int>(mPasses.size()) - 1; p >= 0; --p) {
+        const RenderPassDesc& pass = mPasses[p];
+        bool live = false;
+        for (int output : pass.colorOutputs)
+            live = live || output == kBackbuffer || needed[output];
+        if (pass.depthOutput >= 0)
+            live = live || needed[pass.depthOutput];
+
+        mPassStates[p].live = live;
+        if (!live)
+            continue;
+        for (int input : pass.inputs)
+            needed[input] = true;
+    }
+
+    // lifetimes over the live passes, exports have to survive the frame
+    auto use = [this](int attachment, int p) {
+        AttachmentState& state = mAttachmentStates[attachment];
+        if (state.firstUse < 0)
+            state.firstUse = p;
+        state.lastUse = std::max(state.lastUse, p);
+    };
+    for (int p = 0; p < static_cast<int>(mPasses.size()); ++p) {
+        const RenderPassDesc& pass = mPasses[p];
+        if (!mPassStates[p].live)
+            continue;
+        for (int input : pass.inputs)
+            use(input, p);
+        for (int output : pass.colorOutputs)
+            if (output != kBackbuffer)
+                use(output, p);
+        if (pass.depthOutput >= 0)
+            use(pass.depthOutput, p);
+    }
+    for (size_t a = 0; a < mAttachments.size(); ++a)
+        if (mAttachments[a].exported && mAttachmentStates[a].firstUse >= 0)
+            mAttachmentStates[a].lastUse = static_cast<int>(mPasses.size());
+}
+
+void RenderGraph::assignTextures()
+{
+    for (PooledTexture& pooled : mPool) {
+        pooled.used = false;
+        pooled.busyUntil = -1;
+    }
+
+    // in order of first use, each attachment takes a matching texture that is free by then
+    std::vector<int> order;
+    for (int a = 0; a < static_cast<int>(mAttachments.size()); ++a)
+        if (mAttachmentStates[a].firstUse >= 0)
+            order.push_back(a);
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        return mAttachmentStates[a].firstUse < mAttachmentStates[b].firstUse;
+    });
+
+    for (int a : order) {
+        const AttachmentDesc& desc = mAttachments[a].desc;
+        AttachmentState& state = mAttachmentStates[a];
+        int match = -1;
+        for (int t = 0; t < static_cast<int>(mPool.size()) && match < 0; ++t) {
+            const PooledTexture& pooled = mPool[t];
+            if (pooled.format == desc.format && pooled.width == state.width && pooled.height == state.height
+                && pooled.samples == desc.samples && pooled.layers == desc.layers && pooled.busyUntil < state.firstUse)
+                match = t;
+        }
+
+        if (match < 0) {
+            PooledTexture pooled;
+            pooled.texture = GLTexture::Create();
+            pooled.format = desc.format;
+            pooled.width = state.width;
+            pooled.height = state.height;
+            pooled.samples = desc.samples;
+            pooled.layers = desc.layers;
+
+            if (pooled.layers > 0 && pooled.samples > 1) {
+                GLStateCache::BindTexture(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, pooled.texture.Get());
+                glTexStorage3DMultisample(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, pooled.samples, pooled.format,
+                    pooled.width, pooled.height, pooled.layers, GL_TRUE);
+            }
+            else if (pooled.layers > 0) {
+                GLStateCache::BindTexture(GL_TEXTURE_2D_ARRAY, pooled.texture.Get());
+                glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, pooled.format, pooled.width, pooled.height, pooled.layers);
+                glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            }
+            else if (pooled.samples > 1) {
+                // no sampler state, multisample textures are only read with texelFetch
+                GLStateCache::BindTexture(GL_TEXTURE_2D_MULTISAMPLE, pooled.texture.Get());
+                glTexStorage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, pooled.samples, pooled.format,
+                    pooled.width, pooled.height, GL_TRUE);
+            }
+            else {
+                GLStateCache::BindTexture(GL_TEXTURE_2D, pooled.texture.Get());
+                glTexStorage2D(GL_TEXTURE_2D, 1, pooled.format, pooled.width, pooled.height);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            }
+
+            mPool.push_back(std::move(pooled));
+            match = static_cast<int>(mPool.size()) - 1;
+        }
+
+        mPool[match].used = true;
+        mPool[match].busyUntil = state.lastUse;
+        state.texture = match;
+    }
+
+    // drop what this compile didn't need (old sizes after a resize), keep the indices valid
+    std::vector<int> remap(mPool.size(), -1);
+    std::vector<PooledTexture> kept;
+    for (size_t t = 0; t < mPool.size(); ++t) {
+        if (!mPool[t].used)
+            continue;
+        remap[t] = static_cast<int>(kept.size());
+        kept.push_back(std::move(mPool[t]));
+    }
+    mPool = std::move(kept);
+    for (AttachmentState& state : mAttachmentStates)
+        if (state.texture >= 0)
+            state.texture = remap[state.texture];
+}
+
+void RenderGraph::buildFramebuffers()
+{
+    for (size_t p = 0; p < mPasses.size(); ++p) {
+        const RenderPassDesc& pass = mPasses[p];
+        PassState& state = mPassStates[p];
+        state.framebuffer.Reset();
+        state.backbuffer = false;
+        if (!state.live)
+            continue;
+
+        const std::vector<int>& outputs = pass.colorOutputs;
+        if (std::find(outputs.begin(), outputs.end(), kBackbuffer) != outputs.end()) {
+            state.backbuffer = true;
+            state.width = mOutputWidth;
+            state.height = mOutputHeight;
+            continue;
+        }
+
+        int sizeSource = outputs.empty() ? pass.depthOutput : outputs[0];
+        if (sizeSource >= 0)
+            GetAttachmentSize(sizeSource, state.width, state.height);
+
+        state.framebuffer = GLFramebuffer::Create();
+        GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, state.framebuffer.Get());
+
+        std::vector<unsigned int> drawBuffers;
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            unsigned int point = GL_COLOR_ATTACHMENT0 + static_cast<unsigned int>(i);
+            attach(point, outputs[i], pass, -1);
+            drawBuffers.push_back(point);
+        }
+        if (drawBuffers.empty())
+            glDrawBuffer(GL_NONE);
+        else
+            glDrawBuffers(static_cast<int>(drawBuffers.size()), drawBuffers.data());
+
+        if (pass.depthOutput >= 0) {
+            unsigned int format = mAttachments[pass.depthOutput].desc.format;
+            unsigned int point = format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8
+                ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+            attach(point, pass.depthOutput, pass, -1);
+        }
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "Render graph: framebuffer of pass " << pass.name << " is incomplete" << std::endl;
+    }
+    GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderGraph::attach(unsigned int point, int attachment, const RenderPassDesc& pass, int layer) const
+{
+    unsigned int texture = GetTexture(attachment);
+    if (mAttachments[attachment].desc.layers <= 0)
+        glFramebufferTexture2D(GL_FRAMEBUFFER, point, GetTextureTarget(attachment), texture, 0);
+    else if (layer >= 0)
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, point, texture, 0, layer);
+    else if (pass.viewCount > 1 && mFramebufferTextureMultiview)
+        reinterpret_cast<FramebufferTextureMultiviewProc>(mFramebufferTextureMultiview)(
+            GL_FRAMEBUFFER, point, texture, 0, 0, pass.viewCount);
+    else
+        glFramebufferTexture(GL_FRAMEBUFFER, point, texture, 0);
+}
@@ -0,0 +1,96 @@
+#include "utils/ResourceManager.h"
+#include "utils/MeshOptimizer.h"
+#include "utils/GLStateCache.h"
+#include <glad/glad.h>
+
+unsigned int ResourceManager::CreateTexture()
+{
+    mTextures.push_back(GLTexture::Create());
+    return mTextures.back().Get();
+}
+
+unsigned int ResourceManager::CreateBuffer()
+{
+    mBuffers.push_back(GLBuffer::Create());
+    return mBuffers.back().Get();
+}
+
+unsigned int ResourceManager::CreateVertexArray()
+{
+    mVertexArrays.push_back(GLVertexArray::Create());
+    return mVertexArrays.back().Get();
+}
+
+unsigned int ResourceManager::CreateFramebuffer()
+{
+    mFramebuffers.push_back(GLFramebuffer::Create());
+    return mFramebuffers.back().Get();
+}
+
+unsigned int ResourceManager::CreateRenderbuffer()
+{
+    mRenderbuffers.push_back(GLRenderbuffer::Create());
+    return mRenderbuffers.back().Get();
+}
+
+unsigned int ResourceManager::AdoptProgram(unsigned int program)
+{
+    mPrograms.push_back(GLProgram(program));
+    return program;
+}
+
+unsigned int ResourceManager::AdoptVertexArray(unsigned int vertexArray)
+{
+    mVertexArrays.push_back(GLVertexArray(vertexArray));
+    return vertexArray;
+}
+
+unsigned int ResourceManager::AdoptBuffer(unsigned int buffer)
+{
+    mBuffers.push_back(GLBuffer(buffer));
+    return buffer;
+}
+
+const StaticMesh& ResourceManager::CreateStaticMesh(const std::string& name,
+    const void* vertices, size_t vertexCount, VertexLayout layout,
+    const std::vector<unsigned int>& indices)
+{
+    auto found = mMeshes.find(name);
+    if (found != mMeshes.end())
+        return found->second;
+
+    StaticMesh mesh;
+    mesh.vao = GLVertexArray::Create();
+    mesh.vbo = GLBuffer::Create();
+    mesh.ebo = GLBuffer::Create();
+
+    GLStateCache::BindVertexArray(mesh.vao.Get());
+    GLStateCache::BindBuffer(GL_ARRAY_BUFFER, mesh.vbo.Get());
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * vertexStride(layout), vertices, GL_STATIC_DRAW);
+
+    GLStateCache::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo.Get());
+    mesh.indexType = uploadIndexBuffer(indices, vertexCount, GL_STATIC_DRAW);
+    mesh.indexCount = static_cast<int>(indices.size());
+
+    setupVertexAttributes(layout);
+    GLStateCache::BindVertexArray(0);
+
+    return mMeshes.emplace(name, std::move(mesh)).first->second;
+}
+
+const StaticMesh* ResourceManager::FindStaticMesh(const std::string& name) const
+{
+    auto found = mMeshes.find(name);
+    return found != mMeshes.end() ? &found->second : nullptr;
+}
+
+void ResourceManager::Release()
+{
+    mMeshes.clear();
+    mVertexArrays.clear();
+    mBuffers.clear();
+    mFramebuffers.clear();
+    mRenderbuffers.clear();
+    mTextures.clear();
+    mPrograms.clear();
+}
@@ -0,0 +1,250 @@
+#include "utils/SceneBatch.h"
+#include "utils/GLStateCache.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+
+SceneBatch::SceneBatch(VertexLayout layout, size_t maxVertices, size_t maxIndices, int maxDraws, unsigned int indexType)
+    : mLayout(layout), mMaxVertices(maxVertices), mMaxIndices(maxIndices), mMaxDraws(maxDraws), mIndexType(indexType),
+    mVertexArray(GLVertexArray::Create()), mVertexBuffer(GLBuffer::Create()), mIndexBuffer(GLBuffer::Create()),
+    mDrawIdBuffer(GLBuffer::Create()), mDrawDataBuffer(GLBuffer::Create()), mCommandBuffer(GLBuffer::Create())
+{
+    GLStateCache::BindVertexArray(mVertexArray.Get());
+
+    // dynamic, meshes like the edited ring screen are updated in place
+    GLStateCache::BindBuffer(GL_ARRAY_BUFFER, mVertexBuffer.Get());
+    mVertexData = allocate(GL_ARRAY_BUFFER, mMaxVertices * vertexStride(mLayout), GL_DYNAMIC_DRAW);
+    setupVertexAttributes(mLayout);
+
+    // draw index per instance, baseInstance of a command picks its entry
+    std::vector<unsigned int> drawIds(mMaxDraws);
+    std::iota(drawIds.begin(), drawIds.end(), 0u);
+    GLStateCache::BindBuffer(GL_ARRAY_BUFFER, mDrawIdBuffer.Get());
+    glBufferData(GL_ARRAY_BUFFER, drawIds.size() * sizeof(unsigned int), drawIds.data(), GL_STATIC_DRAW);
+    glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(unsigned int), (void*)0);
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+
+    GLStateCache::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer.Get());
+    mIndexData = allocate(GL_ELEMENT_ARRAY_BUFFER, mMaxIndices * indexSize(), GL_STATIC_DRAW);
+
+    GLStateCache::BindVertexArray(0);
+
+    GLStateCache::BindBuffer(GL_SHADER_STORAGE_BUFFER, mDrawDataBuffer.Get());
+    glBufferData(GL_SHADER_STORAGE_BUFFER, mMaxDraws * sizeof(DrawData), NULL, GL_DYNAMIC_DRAW);
+    GLStateCache::BindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer.Get());
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, mMaxDraws * sizeof(DrawCommand), NULL, GL_DYNAMIC_DRAW);
+}
+
+int SceneBatch::Add(const void* vertices, size_t vertexCount, const void* indices, size_t indexCount,
+    unsigned int indexType, const DrawData& data)
+{
+    int draw = addDraw(vertexCount, indexCount, data);
+    if (draw < 0)
+        return draw;
+
+    const unsigned int stride = vertexStride(mLayout);
+    write(mVertexBuffer.Get(), mVertexData, GetVertexOffset(draw), vertexCount * stride, vertices);
+
+    // one index type per multi-draw, convert on the host; addDraw made sure the mesh fits
+    std::vector<unsigned short> shortIndices;
+    std::vector<unsigned int> intIndices;
+    if (indexType != mIndexType && mIndexType == GL_UNSIGNED_SHORT) {
+        const unsigned int* source = static_cast<const unsigned int*>(indices);
+        shortIndices.assign(source, source + indexCount);
+        indices = shortIndices.data();
+    }
+    else if (indexType != mIndexType) {
+        const unsigned short* source = static_cast<const unsigned short*>(indices);
+        intIndices.assign(source, source + indexCount);
+        indices = intIndices.data();
+    }
+    write(mIndexBuffer.Get(), mIndexData, size_t(mCommands[draw].firstIndex) * indexSize(), indexCount * indexSize(), indices);
+    return draw;
+}
+
+int SceneBatch::Add(const void* vertices, size_t vertexCount, const std::vector<unsigned int>& indices, const DrawData& data)
+{
+    return Add(vertices, vertexCount, indices.data(), indices.size(), GL_UNSIGNED_INT, data);
+}
+
+int SceneBatch::Reserve(size_t vertexCount, size_t indexCount, const DrawData& data)
+{
+    return addDraw(vertexCount, indexCount, data);
+}
+
+bool SceneBatch::Map(int draw, unsigned char*& vertices, void*& indices)
+{
+    const DrawCommand& command = mCommands[draw];
+    const size_t vertexOffset = GetVertexOffset(draw);
+    // draws are packed back to back, the next one starts where this one ends
+    const size_t vertexEnd = draw + 1 < GetDrawCount() ? size_t(mCommands[draw + 1].baseVertex) : mVertexCount;
+    const size_t vertexBytes = (vertexEnd - size_t(command.baseVertex)) * vertexStride(mLayout);
+    const size_t indexOffset = size_t(command.firstIndex) * indexSize();
+    const size_t indexBytes = size_t(command.count) * indexSize();
+    if (mVertexData && mIndexData) {
+        vertices = mVertexData + vertexOffset;
+        indices = mIndexData + indexOffset;
+        return true;
+    }
+
+    // the element array binding is vertex array state, map the indices through the copy target
+    const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+    GLStateCache::BindBuffer(GL_ARRAY_BUFFER, mVertexBuffer.Get());
+    vertices = static_cast<unsigned char*>(glMapBufferRange(GL_ARRAY_BUFFER, vertexOffset, vertexBytes, access));
+    GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, mIndexBuffer.Get());
+    indices = glMapBufferRange(GL_COPY_WRITE_BUFFER, indexOffset, indexBytes, access);
+    if (!vertices || !indices) {
+        std::cerr << "Map scene batch draw " << draw << " failed!" << std::endl;
+        if (vertices)
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        if (indices)
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        return false;
+    }
+    mRangeMapped = true;
+    return true;
+}
+
+void SceneBatch::Unmap()
+{
+    if (!mRangeMapped)
+        return;
+    GLStateCache::BindBuffer(GL_ARRAY_BUFFER, mVertexBuffer.Get());
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, mIndexBuffer.Get());
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    mRangeMapped = false;
+}
+
+void SceneBatch::SetDrawData(int draw, const DrawData& data)
+{
+    mDrawData[draw] = data;
+    mDrawDataDirty = true;
+}
+
+void SceneBatch::SetVisible(int draw, bool visible)
+{
+    unsigned int instanceCount = visible ? mInstanceCount : 0u;
+    if (mCommands[draw].instanceCount == instanceCount)
+        return;
+    mCommands[draw].instanceCount = instanceCount;
+    mCommandsDirty = true;
+}
+
+void SceneBatch::SetInstanceCount(int instances)
+{
+    unsigned int instanceCount = static_cast<unsigned int>(std::max(1, instances));
+    if (instanceCount == mInstanceCount)
+        return;
+    mInstanceCount = instanceCount;
+    for (DrawCommand& command : mCommands)
+        if (command.instanceCount != 0)
+            command.instanceCount = mInstanceCount;
+    mCommandsDirty = true;
+
+    // the draw index is read at baseInstance + instance / divisor
+    GLStateCache::BindVertexArray(mVertexArray.Get());
+    glVertexAttribDivisor(3, mInstanceCount);
+    GLStateCache::BindVertexArray(0);
+}
+
+size_t SceneBatch::GetVertexOffset(int draw) const
+{
+    return size_t(mCommands[draw].baseVertex) * vertexStride(mLayout);
+}
+
+void SceneBatch::Draw(unsigned int drawDataBinding)
+{
+    if (mCommands.empty())
+        return;
+
+    if (mDrawDataDirty) {
+        GLStateCache::BindBuffer(GL_SHADER_STORAGE_BUFFER, mDrawDataBuffer.Get());
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, mDrawData.size() * sizeof(DrawData), mDrawData.data());
+        mDrawDataDirty = false;
+    }
+    GLStateCache::BindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer.Get());
+    if (mCommandsDirty) {
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, mCommands.size() * sizeof(DrawCommand), mCommands.data());
+        mCommandsDirty = false;
+    }
+
+    GLStateCache::BindBufferBase(GL_SHADER_STORAGE_BUFFER, drawDataBinding, mDrawDataBuffer.Get());
+    GLStateCache::BindVertexArray(mVertexArray.Get());
+    glMultiDrawElementsIndirect(GL_TRIANGLES, mIndexType, (void*)0, static_cast<GLsizei>(mCommands.size()), 0);
+}
+
+void SceneBatch::Release()
+{
+    // deleting the buffers unmaps them
+    mVertexData = nullptr;
+    mIndexData = nullptr;
+    mVertexArray.Reset();
+    mVertexBuffer.Reset();
+    mIndexBuffer.Reset();
+    mDrawIdBuffer.Reset();
+    mDrawDataBuffer.Reset();
+    mCommandBuffer.Reset();
+}
+
+int SceneBatch::addDraw(size_t vertexCount, size_t indexCount, const DrawData& data)
+{
+    if (static_cast<int>(mCommands.size()) >= mMaxDraws || mVertexCount + vertexCount > mMaxVertices
+        || mIndexCount + indexCount > mMaxIndices) {
+        std::cerr << "Scene batch is full: " << mCommands.size() << " draws, " << mVertexCount << " vertices, "
+            << mIndexCount << " indices" << std::endl;
+        return -1;
+    }
+    if (mIndexType == GL_UNSIGNED_SHORT && vertexCount > 0x10000) {
+        std::cerr << "Scene batch mesh of " << vertexCount << " vertices needs 32-bit indices" << std::endl;
+        return -1;
+    }
+
+    DrawCommand command;
+    command.count = static_cast<unsigned int>(indexCount);
+    command.instanceCount = mInstanceCount;
+    command.firstIndex = static_cast<unsigned int>(mIndexCount);
+    command.baseVertex = static_cast<int>(mVertexCount);
+    command.baseInstance = static_cast<unsigned int>(mCommands.size());
+    mCommands.push_back(command);
+    mDrawData.push_back(data);
+    mCommandsDirty = true;
+    mDrawDataDirty = true;
+
+    mVertexCount += vertexCount;
+    mIndexCount += indexCount;
+    return static_cast<int>(mCommands.size()) - 1;
+}
+
+unsigned char* SceneBatch::allocate(unsigned int target, size_t bytes, unsigned int usage)
+{
+    unsigned char* mapped = nullptr;
+    if (GLAD_GL_VERSION_4_4) {
+        // dynamic storage keeps glBufferSubData for in-place edits of draws the GPU may be reading
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, bytes, NULL, flags | GL_DYNAMIC_STORAGE_BIT);
+        mapped = static_cast<unsigned char*>(glMapBufferRange(target, 0, bytes, flags));
+    }
+    if (!mapped)
+        glBufferData(target, bytes, NULL, usage);
+    return mapped;
+}
+
+void SceneBatch::write(unsigned int buffer, unsigned char* mapped, size_t offset, size_t bytes, const void* data)
+{
+    if (mapped) {
+        std::memcpy(mapped + offset, data, bytes);
+        return;
+    }
+    // the element array binding is vertex array state, write through the copy target
+    GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offset, bytes, data);
+}
+
+size_t SceneBatch::indexSize() const noexcept
+{
+    return mIndexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+}
@@ -0,0 +1,139 @@
+#include "utils/ScreenEditor.h"
+#include "utils/GLStateCache.h"
+#include <glad/glad.h>
+#include <chrono>
+#include <iostream>
+
+constexpr float RingScreenEditor::kEditBudgetMs;
+
+RingScreenEditor::RingScreenEditor(int segmentsU, int segmentsV, VertexLayout layout, const RingScreenParams& params)
+    : mSegmentsU(segmentsU), mSegmentsV(segmentsV), mLayout(layout), mParams(params)
+{
+    GenerateControlPoints4x4(mControlPoints, mParams.radius, mParams.height, mParams.arcAngle);
+    updateBasisU();
+
+    mBasisV.resize(segmentsV + 1);
+    mDerivV.resize(segmentsV + 1);
+    for (int c = 0; c <= segmentsV; ++c) {
+        float v = float(c) / segmentsV;
+        for (int k = 0; k < 4; ++k) {
+            mBasisV[c][k] = bernstein(k, v);
+            mDerivV[c][k] = bernsteinDeriv(k, v);
+        }
+    }
+
+    mPacked.resize(size_t(segmentsU + 1) * (segmentsV + 1) * vertexStride(layout));
+}
+
+void RingScreenEditor::updateBasisU()
+{
+    if (mArcLengthUV)
+        mArcLength.Build(mControlPoints);
+
+    mBasisU.resize(mSegmentsU + 1);
+    mDerivU.resize(mSegmentsU + 1);
+    for (int r = 0; r <= mSegmentsU; ++r) {
+        float u = float(r) / mSegmentsU;
+        float t = mArcLengthUV ? mArcLength.Parameter(u) : u;
+        for (int k = 0; k < 4; ++k) {
+            mBasisU[r][k] = bernstein(k, t);
+            mDerivU[r][k] = bernsteinDeriv(k, t);
+        }
+    }
+    mBasisUStale = false;
+}
+
+void RingScreenEditor::SetArcLengthUV(bool enable)
+{
+    if (mArcLengthUV == enable)
+        return;
+
+    mArcLengthUV = enable;
+    mBasisUStale = true;
+    mDirty = true;
+}
+
+void RingScreenEditor::SetParams(const RingScreenParams& params)
+{
+    mParams = params;
+
+    glm::vec3 controlPoints[4][4];
+    GenerateControlPoints4x4(controlPoints, params.radius, params.height, params.arcAngle);
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            SetControlPoint(i, j, controlPoints[i][j]);
+}
+
+void RingScreenEditor::SetControlPoint(int i, int j, const glm::vec3& point)
+{
+    if (mControlPoints[i][j] == point)
+        return;
+
+    mControlPoints[i][j] = point;
+    // arc length rows follow the curve
+    if (mArcLengthUV)
+        mBasisUStale = true;
+    mDirty = true;
+}
+
+void RingScreenEditor::GetControlPoints(glm::vec3 controlPoints[4][4]) const
+{
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            controlPoints[i][j] = mControlPoints[i][j];
+}
+
+void RingScreenEditor::evaluateGrid()
+{
+    const unsigned int stride = vertexStride(mLayout);
+    const int rowVerts = mSegmentsV + 1;
+
+    for (int r = 0; r <= mSegmentsU; ++r) {
+        // collapse the u direction first: 4 curve points and their u derivatives for this row
+        glm::vec3 q[4], dq[4];
+        for (int j = 0; j < 4; ++j) {
+            q[j] = glm::vec3(0.0f);
+            dq[j] = glm::vec3(0.0f);
+            for (int i = 0; i < 4; ++i) {
+                q[j] += mBasisU[r][i] * mControlPoints[i][j];
+                dq[j] += mDerivU[r][i] * mControlPoints[i][j];
+            }
+        }
+
+        float u = float(r) / mSegmentsU;
+        for (int c = 0; c <= mSegmentsV; ++c) {
+            glm::vec3 pos(0.0f), du(0.0f), dv(0.0f);
+            for (int j = 0; j < 4; ++j) {
+                pos += mBasisV[c][j] * q[j];
+                du += mBasisV[c][j] * dq[j];
+                dv += mDerivV[c][j] * q[j];
+            }
+            glm::vec3 normal = glm::normalize(glm::cross(du, dv));
+
+            float vertex[8] = { pos.x, pos.y, pos.z, normal.x, normal.y, normal.z, u, float(c) / mSegmentsV };
+            packVertices(vertex, 1, mLayout, mPacked.data() + size_t(r * rowVerts + c) * stride);
+        }
+    }
+}
+
+float RingScreenEditor::Update(unsigned int vbo, size_t baseOffset)
+{
+    if (!mDirty)
+        return 0.0f;
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (mBasisUStale)
+        updateBasisU();
+
+    evaluateGrid();
+
+    GLStateCache::BindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, baseOffset, mPacked.size(), mPacked.data());
+    mDirty = false;
+
+    float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (ms > kEditBudgetMs)
+        std::cerr << "Screen edit took " << ms << " ms, budget is " << kEditBudgetMs << " ms" << std::endl;
+    return ms;
+}
@@ -0,0 +1,285 @@
+#include "utils/ScreenPicker.h"
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <iostream>
+#include <random>
+
+constexpr float RingScreenPicker::kPickBudgetUs;
+
+namespace {
+
+    // leaves hold at most this many triangles
+    const int kLeafTriangles = 4;
+    // Newton steps from the coarse hit onto the patch, converges in 2-3
+    const int kRefineIterations = 4;
+
+    bool intersectBox(const glm::vec3& boxMin, const glm::vec3& boxMax,
+        const glm::vec3& origin, const glm::vec3& invDirection, float maxDistance)
+    {
+        glm::vec3 t0 = (boxMin - origin) * invDirection;
+        glm::vec3 t1 = (boxMax - origin) * invDirection;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+        float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+        return enter <= exit;
+    }
+}
+
+void RingScreenPicker::Build(const glm::vec3 controlPoints[4][4], bool arcLengthUV, int segments)
+{
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            mControlPoints[i][j] = controlPoints[i][j];
+
+    mArcLengthUV = arcLengthUV;
+    if (arcLengthUV)
+        mArcLength.Build(controlPoints);
+
+    // coarse grid, the hit is refined on the patch anyway
+    const int rowVerts = segments + 1;
+    mPositions.resize(size_t(rowVerts) * rowVerts);
+    mParams.resize(mPositions.size());
+    for (int i = 0; i <= segments; ++i) {
+        for (int j = 0; j <= segments; ++j) {
+            glm::vec2 params(float(i) / segments, float(j) / segments);
+            mPositions[i * rowVerts + j] = bezierSurfacePoint(controlPoints, params.x, params.y);
+            mParams[i * rowVerts + j] = params;
+        }
+    }
+
+    // same winding as the rendered grid, so the front side is the visible one
+    mTriangles.clear();
+    mTriangles.reserve(size_t(segments) * segments * 2);
+    for (int i = 0; i < segments; ++i) {
+        for (int j = 0; j < segments; ++j) {
+            int idx = i * rowVerts + j;
+            mTriangles.push_back(glm::ivec3(idx, idx + rowVerts, idx + rowVerts + 1));
+            mTriangles.push_back(glm::ivec3(idx, idx + rowVerts + 1, idx + 1));
+        }
+    }
+
+    mNodes.clear();
+    mNodes.reserve(mTriangles.size() * 2 / kLeafTriangles + 1);
+    buildNode(0, int(mTriangles.size()));
+}
+
+int RingScreenPicker::buildNode(int begin, int end)
+{
+    int index = int(mNodes.size());
+    mNodes.push_back(Node());
+
+    glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+    glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+    for (int t = begin; t < end; ++t) {
+        glm::vec3 centroid(0.0f);
+        for (int k = 0; k < 3; ++k) {
+            const glm::vec3& p = mPositions[mTriangles[t][k]];
+            boxMin = glm::min(boxMin, p);
+            boxMax = glm::max(boxMax, p);
+            centroid += p / 3.0f;
+        }
+        centroidMin = glm::min(centroidMin, centroid);
+        centroidMax = glm::max(centroidMax, centroid);
+    }
+    mNodes[index].boxMin = boxMin;
+    mNodes[index].boxMax = boxMax;
+
+    if (end - begin <= kLeafTriangles) {
+        mNodes[index].offset = begin;
+        mNodes[index].count = end - begin;
+        return index;
+    }
+
+    // median split along the longest centroid extent
+    glm::vec3 extent = centroidMax - centroidMin;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+    int mid = (begin + end) / 2;
+    auto centroidOnAxis = [&](const glm::ivec3& t) {
+        return mPositions[t.x][axis] + mPositions[t.y][axis] + mPositions[t.z][axis];
+    };
+    std::nth_element(mTriangles.begin() + begin, mTriangles.begin() + mid, mTriangles.begin() + end,
+        [&](const glm::ivec3& a, const glm::ivec3& b) { return centroidOnAxis(a) < centroidOnAxis(b); });
+
+    buildNode(begin, mid);
+    int right = buildNode(mid, end);
+    mNodes[index].offset = right;
+    mNodes[index].count = 0;
+    return index;
+}
+
+void RingScreenPicker::SetModelMatrix(const glm::mat4& model)
+{
+    mLocalToWorld = model;
+    mWorldToLocal = glm::inverse(model);
+}
+
+void RingScreenPicker::SetDesktopSize(int width, int height)
+{
+    mDesktopWidth = width;
+    mDesktopHeight = height;
+}
+
+bool RingScreenPicker::intersectTriangle(int triangle, const glm::vec3& origin, const glm::vec3& direction,
+    float& distance, glm::vec2& params) const
+{
+    // Moller-Trumbore, back faces rejected
+    const glm::ivec3& t = mTriangles[triangle];
+    const glm::vec3& p0 = mPositions[t.x];
+    glm::vec3 e1 = mPositions[t.y] - p0;
+    glm::vec3 e2 = mPositions[t.z] - p0;
+    glm::vec3 pv = glm::cross(direction, e2);
+    float det = glm::dot(e1, pv);
+    if (det <= 1e-12f)
+        return false;
+
+    float invDet = 1.0f / det;
+    glm::vec3 tv = origin - p0;
+    float b1 = glm::dot(tv, pv) * invDet;
+    if (b1 < 0.0f || b1 > 1.0f)
+        return false;
+    glm::vec3 qv = glm::cross(tv, e1);
+    float b2 = glm::dot(direction, qv) * invDet;
+    if (b2 < 0.0f || b1 + b2 > 1.0f)
+        return false;
+    float d = glm::dot(e2, qv) * invDet;
+    if (d <= 0.0f || d >= distance)
+        return false;
+
+    distance = d;
+    params = (1.0f - b1 - b2) * mParams[t.x] + b1 * mParams[t.y] + b2 * mParams[t.z];
+    return true;
+}
+
+void RingScreenPicker::refine(const glm::vec3& origin, const glm::vec3& direction, float& distance, glm::vec2& params) const
+{
+    // solve P(u, v) = origin + distance * direction for (u, v, distance)
+    for (int it = 0; it < kRefineIterations; ++it) {
+        glm::vec4 bu, dbu, bv, dbv;
+        for (int k = 0; k < 4; ++k) {
+            bu[k] = bernstein(k, params.x);
+            dbu[k] = bernsteinDeriv(k, params.x);
+            bv[k] = bernstein(k, params.y);
+            dbv[k] = bernsteinDeriv(k, params.y);
+        }
+
+        glm::vec3 pos(0.0f), du(0.0f), dv(0.0f);
+        for (int i = 0; i < 4; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                pos += bu[i] * bv[j] * mControlPoints[i][j];
+                du += dbu[i] * bv[j] * mControlPoints[i][j];
+                dv += bu[i] * dbv[j] * mControlPoints[i][j];
+            }
+        }
+
+        glm::vec3 residual = pos - (origin + distance * direction);
+        if (glm::dot(residual, residual) < 1e-12f)
+            break;
+
+        glm::mat3 jacobian(du, dv, -direction);
+        if (std::abs(glm::determinant(jacobian)) < 1e-12f)
+            break;
+        glm::vec3 step = glm::inverse(jacobian) * residual;
+        params = glm::clamp(params - glm::vec2(step.x, step.y), 0.0f, 1.0f);
+        distance -= step.z;
+    }
+}
+
+bool RingScreenPicker::Pick(const glm::vec3& origin, const glm::vec3& direction, ScreenHit& hit) const
+{
+    if (mNodes.empty())
+        return false;
+
+    // in local space, distances stay in units of the world direction
+    glm::vec3 localOrigin = glm::vec3(mWorldToLocal * glm::vec4(origin, 1.0f));
+    glm::vec3 localDirection = glm::vec3(mWorldToLocal * glm::vec4(direction, 0.0f));
+    glm::vec3 invDirection = 1.0f / localDirection;
+
+    float distance = FLT_MAX;
+    glm::vec2 params;
+    bool found = false;
+
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        int index = stack[--top];
+        const Node& node = mNodes[index];
+        if (!intersectBox(node.boxMin, node.boxMax, localOrigin, invDirection, distance))
+            continue;
+
+        if (node.count > 0) {
+            for (int t = node.offset; t < node.offset + node.count; ++t)
+                found |= intersectTriangle(t, localOrigin, localDirection, distance, params);
+        }
+        else {
+            stack[top++] = node.offset;
+            stack[top++] = index + 1;
+        }
+    }
+    if (!found)
+        return false;
+
+    refine(localOrigin, localDirection, distance, params);
+
+    hit.distance = distance;
+    hit.position = origin + distance * direction;
+    hit.uv = TextureCoords(params);
+    hit.pixel = DesktopPixel(hit.uv);
+    return true;
+}
+
+glm::vec3 RingScreenPicker::SurfacePoint(const glm::vec2& params) const
+{
+    return glm::vec3(mLocalToWorld * glm::vec4(bezierSurfacePoint(mControlPoints, params.x, params.y), 1.0f));
+}
+
+glm::vec2 RingScreenPicker::TextureCoords(const glm::vec2& params) const
+{
+    return glm::vec2(mArcLengthUV ? mArcLength.ArcFraction(params.x) : params.x, params.y);
+}
+
+glm::ivec2 RingScreenPicker::DesktopPixel(const glm::vec2& uv) const
+{
+    // the scene shader samples the desktop at (1 - u, v)
+    int x = int((1.0f - uv.x) * mDesktopWidth);
+    int y = int(uv.y * mDesktopHeight);
+    return glm::ivec2(glm::clamp(x, 0, mDesktopWidth - 1), glm::clamp(y, 0, mDesktopHeight - 1));
+}
+
+void printPickReport(const RingScreenPicker& picker, const glm::vec3& eye, int rayCount)
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(0.01f, 0.99f);
+
+    std::vector<glm::vec3> directions(rayCount);
+    std::vector<glm::ivec2> expected(rayCount);
+    for (int r = 0; r < rayCount; ++r) {
+        glm::vec2 params(dist(rng), dist(rng));
+        directions[r] = glm::normalize(picker.SurfacePoint(params) - eye);
+        expected[r] = picker.DesktopPixel(picker.TextureCoords(params));
+    }
+
+    std::vector<ScreenHit> hits(rayCount);
+    std::vector<char> hitFlags(rayCount);
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rayCount; ++r)
+        hitFlags[r] = picker.Pick(eye, directions[r], hits[r]);
+    float us = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count() / rayCount;
+
+    int hitCount = 0;
+    int maxError = 0;
+    for (int r = 0; r < rayCount; ++r) {
+        if (!hitFlags[r])
+            continue;
+        ++hitCount;
+        glm::ivec2 error = glm::abs(hits[r].pixel - expected[r]);
+        maxError = std::max(maxError, std::max(error.x, error.y));
+    }
+
+    std::cout << "Screen picking: " << hitCount << "/" << rayCount << " hits, " << us << " us per pick, max error "
+        << maxError << " px" << std::endl;
+    if (us > RingScreenPicker::kPickBudgetUs)
+        std::cerr << "Screen picking took " << us << " us, budget is " << RingScreenPicker::kPickBudgetUs << " us" << std::endl;
+}
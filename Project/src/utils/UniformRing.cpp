@@ -0,0 +1,136 @@
+#include "utils/UniformRing.h"
+#include "utils/GLStateCache.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+UniformRing::UniformRing(size_t frameBytes, int framesInFlight)
+    : mBuffer(GLBuffer::Create()), mFrameBytes(frameBytes), mFramesInFlight(framesInFlight),
+    mFences(framesInFlight, nullptr)
+{
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment > 0)
+        mAlignment = static_cast<size_t>(alignment);
+    mFrameBytes = (mFrameBytes + mAlignment - 1) / mAlignment * mAlignment;
+    allocate();
+}
+
+UniformRing::~UniformRing()
+{
+    Release();
+}
+
+void UniformRing::allocate()
+{
+    const size_t totalBytes = mFrameBytes * mFramesInFlight;
+    GLStateCache::BindBuffer(GL_UNIFORM_BUFFER, mBuffer.Get());
+    if (GLAD_GL_VERSION_4_4) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, totalBytes, NULL, flags);
+        mMapped = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, totalBytes, flags));
+    }
+    if (!mMapped)
+        glBufferData(GL_UNIFORM_BUFFER, totalBytes, NULL, GL_STREAM_DRAW);
+}
+
+void UniformRing::grow(size_t frameBytes)
+{
+    size_t grown = mFrameBytes;
+    while (grown < frameBytes)
+        grown *= 2;
+    std::cout << "Uniform ring: frame region grows from " << mFrameBytes << " to " << grown << " bytes" << std::endl;
+
+    if (mMapped) {
+        GLStateCache::BindBuffer(GL_UNIFORM_BUFFER, mBuffer.Get());
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        mMapped = nullptr;
+    }
+    RetiredBuffer retired;
+    retired.buffer = std::move(mBuffer);
+    retired.lastFrame = mFrameNumber;
+    mRetired.push_back(std::move(retired));
+
+    mBuffer = GLBuffer::Create();
+    mFrameBytes = grown;
+    mHead = 0;
+    allocate();
+}
+
+void UniformRing::BeginFrame()
+{
+    mFrame = (mFrame + 1) % mFramesInFlight;
+    ++mFrameNumber;
+    mHead = 0;
+
+    GLsync fence = static_cast<GLsync>(mFences[mFrame]);
+    if (!fence)
+        return;
+
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        ++mStalls;
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    mFences[mFrame] = nullptr;
+
+    // the fence was the one of the frame framesInFlight back, buffers retired up to it are free
+    const long long finished = mFrameNumber - mFramesInFlight;
+    mRetired.erase(std::remove_if(mRetired.begin(), mRetired.end(),
+        [finished](const RetiredBuffer& retired) { return retired.lastFrame <= finished; }), mRetired.end());
+}
+
+void UniformRing::EndFrame()
+{
+    if (mFrame >= 0)
+        mFences[mFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+size_t UniformRing::Push(const void* data, size_t bytes)
+{
+    size_t aligned = (bytes + mAlignment - 1) / mAlignment * mAlignment;
+    if (mHead + aligned > mFrameBytes)
+        grow(mHead + aligned);
+
+    size_t offset = size_t(mFrame < 0 ? 0 : mFrame) * mFrameBytes + mHead;
+    mHead += aligned;
+
+    if (mMapped) {
+        std::memcpy(mMapped + offset, data, bytes);
+    }
+    else {
+        GLStateCache::BindBuffer(GL_UNIFORM_BUFFER, mBuffer.Get());
+        void* dst = glMapBufferRange(GL_UNIFORM_BUFFER, offset, bytes,
+            GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        if (dst) {
+            std::memcpy(dst, data, bytes);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+        }
+    }
+    return offset;
+}
+
+void UniformRing::Bind(unsigned int binding, size_t offset, size_t bytes) const
+{
+    GLStateCache::BindBufferRange(GL_UNIFORM_BUFFER, binding, mBuffer.Get(), offset, bytes);
+}
+
+void UniformRing::Release()
+{
+    for (void*& fence : mFences) {
+        if (fence)
+            glDeleteSync(static_cast<GLsync>(fence));
+        fence = nullptr;
+    }
+    if (mMapped) {
+        GLStateCache::BindBuffer(GL_UNIFORM_BUFFER, mBuffer.Get());
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        mMapped = nullptr;
+    }
+    mBuffer.Reset();
+    mRetired.clear();
+}
@@ -0,0 +1,97 @@
+#include "utils/VertexFormat.h"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <cstring>
+#include <cstdint>
+
+namespace {
+
+    // pos, normal, uv
+    const size_t kFloatsPerVertex = 8;
+
+    void packPackedVertex(const float* v, VertexLayout layout, unsigned char* dst)
+    {
+        size_t offset = 0;
+        if (layout == VertexLayout::PackedHalf) {
+            // w is padding, keeps the normal 4-byte aligned
+            uint16_t pos[4] = {
+                glm::packHalf1x16(v[0]),
+                glm::packHalf1x16(v[1]),
+                glm::packHalf1x16(v[2]),
+                glm::packHalf1x16(1.0f) };
+            std::memcpy(dst, pos, sizeof(pos));
+            offset = sizeof(pos);
+        }
+        else {
+            std::memcpy(dst, v, 3 * sizeof(float));
+            offset = 3 * sizeof(float);
+        }
+
+        uint32_t normal = glm::packSnorm3x10_1x2(glm::vec4(v[3], v[4], v[5], 0.0f));
+        std::memcpy(dst + offset, &normal, sizeof(normal));
+        offset += sizeof(normal);
+
+        uint16_t uv[2] = { glm::packUnorm1x16(v[6]), glm::packUnorm1x16(v[7]) };
+        std::memcpy(dst + offset, uv, sizeof(uv));
+    }
+}
+
+unsigned int vertexStride(VertexLayout layout)
+{
+    switch (layout) {
+        case VertexLayout::Float32:     return 8 * sizeof(float);
+        case VertexLayout::PackedFloat: return 3 * sizeof(float) + 4 + 2 * sizeof(uint16_t);
+        case VertexLayout::PackedHalf:  return 4 * sizeof(uint16_t) + 4 + 2 * sizeof(uint16_t);
+    }
+    return 8 * sizeof(float);
+}
+
+void packVertices(const float* src, size_t vertexCount, VertexLayout layout, unsigned char* dst)
+{
+    if (layout == VertexLayout::Float32) {
+        std::memcpy(dst, src, vertexCount * kFloatsPerVertex * sizeof(float));
+        return;
+    }
+
+    const unsigned int stride = vertexStride(layout);
+    for (size_t i = 0; i < vertexCount; ++i)
+        packPackedVertex(src + i * kFloatsPerVertex, layout, dst + i * stride);
+}
+
+void packVertices(const std::vector<float>& src, VertexLayout layout, std::vector<unsigned char>& dst)
+{
+    size_t vertexCount = src.size() / kFloatsPerVertex;
+    dst.resize(vertexCount * vertexStride(layout));
+    packVertices(src.data(), vertexCount, layout, dst.data());
+}
+
+void setupVertexAttributes(VertexLayout layout)
+{
+    GLsizei stride = vertexStride(layout);
+
+    switch (layout) {
+    case VertexLayout::Float32:
+        // pos attribute
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+        // nor attribute
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+        // tex attribute
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
+        break;
+    case VertexLayout::PackedFloat:
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)12);
+        glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)16);
+        break;
+    case VertexLayout::PackedHalf:
+        glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, stride, (void*)0);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)8);
+        glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)12);
+        break;
+    }
+
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+}
@@ -0,0 +1,137 @@
+// Checks of the radial lens model (LensProfile.h) without a GL context: the Newton
+// inverse against the forward polynomial, and where it has to give up past the fold.
+#include "utils/LensProfile.h"
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+
+    // panel radius error of a solved inverse, in [-1, 1] eye image coordinates (1e-5 is
+    // a hundredth of a pixel in a 2000 px eye)
+    const float kRoundTripTolerance = 1e-5f;
+    // how far from the fold a panel radius has to be for the test to expect an answer
+    const float kFoldMargin = 1e-3f;
+    // largest panel radius of an eye image, a corner seen from an off-center lens
+    const float kImageRadius = 1.6f;
+
+    int failures = 0;
+
+    void fail(const LensProfile& profile, int channel, const std::string& message)
+    {
+        std::cerr << "FAIL " << profile.name << " channel " << channel << ": " << message << std::endl;
+        ++failures;
+    }
+
+    // largest panel radius the monotonic part of the polynomial reaches, infinity when
+    // it does not fold within the image
+    float foldPanelRadius(const LensProfile& profile, int channel)
+    {
+        float previous = 0.0f;
+        for (float radius = 1e-4f; radius < 2.0f * kImageRadius; radius += 1e-4f) {
+            float panel = lensPanelRadius(profile, channel, radius);
+            if (panel <= previous)
+                return previous;
+            previous = panel;
+        }
+        return std::numeric_limits<float>::infinity();
+    }
+
+    // every panel radius of the image: solved exactly below the fold, unsolved past it
+    void testInverse(const LensProfile& profile, int channel)
+    {
+        const float fold = foldPanelRadius(profile, channel);
+        for (float panel = 0.0f; panel <= kImageRadius; panel += 1e-3f) {
+            float radius = -1.0f;
+            bool solved = lensViewRadius(profile, channel, panel, radius);
+            if (std::abs(panel - fold) < kFoldMargin)
+                continue;
+            if (panel > fold) {
+                if (solved)
+                    fail(profile, channel, "panel radius " + std::to_string(panel) + " past the fold at "
+                        + std::to_string(fold) + " solved to " + std::to_string(radius));
+                continue;
+            }
+            if (!solved) {
+                fail(profile, channel, "panel radius " + std::to_string(panel) + " before the fold not solved");
+                continue;
+            }
+            float error = std::abs(lensPanelRadius(profile, channel, radius) - panel);
+            if (error > kRoundTripTolerance)
+                fail(profile, channel, "panel radius " + std::to_string(panel) + " misses the forward model by "
+                    + std::to_string(error));
+        }
+    }
+
+    // texel centers of a LensLut: the scene coordinates go forward to the texel again,
+    // texels beyond the fold are unsolved. Returns the unsolved count
+    int testTexels(const LensProfile& profile, int channel, int size)
+    {
+        const float fold = foldPanelRadius(profile, channel);
+        int unsolved = 0;
+        for (int eye = 0; eye < 2; ++eye) {
+            const glm::vec2 center = lensCenter(profile, eye);
+            for (int y = 0; y < size; ++y) {
+                for (int x = 0; x < size; ++x) {
+                    glm::vec2 position((x + 0.5f) / size, (y + 0.5f) / size);
+                    float panel = glm::length(position * 2.0f - 1.0f - center);
+                    glm::vec2 scene;
+                    bool solved = lensSceneCoordinates(profile, eye, channel, position, scene);
+                    unsolved += solved ? 0 : 1;
+                    if (std::abs(panel - fold) < kFoldMargin)
+                        continue;
+                    if (solved != (panel < fold)) {
+                        fail(profile, channel, "texel " + std::to_string(x) + ", " + std::to_string(y) + " of eye "
+                            + std::to_string(eye) + (solved ? " past the fold solved" : " before the fold unsolved"));
+                        continue;
+                    }
+                    if (!solved)
+                        continue;
+                    glm::vec2 view = scene * 2.0f - 1.0f - center;
+                    float radius = glm::length(view);
+                    glm::vec2 back = center + (radius > 0.0f ? view * (lensPanelRadius(profile, channel, radius) / radius) : view);
+                    float error = glm::length(back * 0.5f + 0.5f - position);
+                    if (error > kRoundTripTolerance)
+                        fail(profile, channel, "texel " + std::to_string(x) + ", " + std::to_string(y)
+                            + " misses the forward model by " + std::to_string(error));
+                }
+            }
+        }
+        return unsolved;
+    }
+}
+
+int main()
+{
+    std::vector<LensProfile> profiles = { defaultLensProfile() };
+    if (!loadLensProfiles("lens_profiles.txt", profiles))
+        ++failures;
+
+    // a strong pincushion lens folds inside the image: r - 0.5 r^3 turns at r = 0.816
+    LensProfile folding;
+    folding.name = "folding";
+    folding.k1 = -0.5f;
+    folding.channelScale = glm::vec3(0.99f, 1.0f, 1.01f);
+    folding.centerOffset = 0.05f;
+    profiles.push_back(folding);
+
+    for (const LensProfile& profile : profiles) {
+        int unsolved = 0;
+        for (int channel = 0; channel < 3; ++channel) {
+            testInverse(profile, channel);
+            unsolved += testTexels(profile, channel, 64);
+        }
+        std::cout << profile.name << ": " << unsolved << " texels unsolved" << std::endl;
+        if (&profile == &profiles.back() && unsolved == 0)
+            fail(profile, 0, "no texel past the fold");
+    }
+
+    if (failures > 0) {
+        std::cerr << failures << " lens profile checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "lens profile checks passed" << std::endl;
+    return 0;
+}